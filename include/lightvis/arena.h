@@ -0,0 +1,81 @@
+#ifndef LIGHTVIS_ARENA_H
+#define LIGHTVIS_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace lightvis {
+
+// Bump allocator for per-frame transient data. Nothing is freed individually,
+// reset() releases everything at once and keeps the memory for the next frame,
+// so frames of a steady size run without touching the heap.
+class Arena {
+  public:
+    Arena(size_t block_size = 64 * 1024);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    size_t used() const {
+        return used_size;
+    }
+    size_t capacity() const;
+
+  private:
+    struct block_t {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    std::vector<block_t> blocks;
+    size_t block_size;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used_size = 0;
+};
+
+template <typename T>
+class ArenaAllocator {
+    template <typename U>
+    friend class ArenaAllocator;
+
+  public:
+    using value_type = T;
+
+    ArenaAllocator(Arena &arena) noexcept :
+        arena(&arena) {
+    }
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept :
+        arena(other.arena) {
+    }
+
+    T *allocate(size_t n) {
+        return (T *)arena->allocate(n * sizeof(T), alignof(T));
+    }
+    void deallocate(T *, size_t) noexcept {
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept {
+        return arena == other.arena;
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const noexcept {
+        return arena != other.arena;
+    }
+
+  private:
+    Arena *arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_ARENA_H
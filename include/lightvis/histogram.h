@@ -0,0 +1,72 @@
+#ifndef LIGHTVIS_HISTOGRAM_H
+#define LIGHTVIS_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lightvis {
+
+// Fixed-width bins over [lo, hi) filled from a stream of samples. One producer thread
+// push()es into a lock-free ring and the drawing thread bins whatever arrived in
+// update(), in batches, so each sample costs constant time and none are stored.
+// Samples outside the range are counted as underflow or overflow. When the ring is
+// full, push() drops the sample and counts it in dropped().
+class Histogram {
+  public:
+    Histogram(double lo, double hi, size_t bins = 64, size_t capacity = 65536);
+    Histogram(const Histogram &) = delete;
+    Histogram &operator=(const Histogram &) = delete;
+
+    // Only for the producer thread.
+    bool push(double sample);
+    size_t push(const double *samples, size_t count);
+
+    // Only for the consumer thread, which is the drawing thread for histogram widgets.
+    void update();
+    void clear();
+
+    double lo() const {
+        return range_lo;
+    }
+    double hi() const {
+        return range_hi;
+    }
+    const std::vector<std::uint64_t> &counts() const {
+        return bins;
+    }
+    std::uint64_t underflow() const {
+        return below;
+    }
+    std::uint64_t overflow() const {
+        return above;
+    }
+    std::uint64_t total() const {
+        return binned;
+    }
+    std::uint64_t dropped() const {
+        return drops.load(std::memory_order_relaxed);
+    }
+
+  private:
+    void bin(const double *samples, size_t count);
+
+    double range_lo;
+    double range_hi;
+    double inv_width;
+    std::vector<std::uint64_t> bins;
+    std::uint64_t below = 0;
+    std::uint64_t above = 0;
+    std::uint64_t binned = 0;
+
+    std::vector<double> ring;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    std::atomic<std::uint64_t> drops = 0;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_HISTOGRAM_H
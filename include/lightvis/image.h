@@ -1,6 +1,9 @@
 #ifndef LIGHTVIS_IMAGE_H
 #define LIGHTVIS_IMAGE_H
 
+#include <functional>
+#include <memory>
+#include <vector>
 #include <Eigen/Eigen>
 #include <opencv2/opencv.hpp>
 #include <glbinding/gl/gl.h>
@@ -8,34 +11,73 @@
 
 namespace lightvis {
 
-struct Image {
-    Image() {
-        gl::glGenTextures(1, &texture_id);
-        gl::glBindTexture(gl::GL_TEXTURE_2D, texture_id);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR_MIPMAP_LINEAR);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
-        gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
-        nuklear_image = nk_image_id((int)texture_id);
-
-        // update_image(image);
-    }
+struct image_texture_t;
 
-    ~Image() {
-        gl::glDeleteTextures(1, &texture_id);
-    }
+struct ImageTile {
+    gl::GLuint texture_id;
+    Eigen::Vector2i texture_size;
+    // Part of the image covered by the tile, in image pixels.
+    Eigen::Vector2f lo;
+    Eigen::Vector2f hi;
+};
+
+struct Image {
+    // Images own no GL objects until update_image(), so they can be constructed before
+    // the window's context exists. Live images are registered for upload_image_textures().
+    Image();
+    Image(const Image &other);
+    Image &operator=(const Image &other);
+    ~Image();
 
     bool empty() const {
         return (size.x() == 0 || size.y() == 0);
     }
 
+    // Textures are shared by content: images updated with identical pixels refer to
+    // one texture, uploaded and mipmapped once for all windows. With a current context,
+    // as in gui() and draw(), the texture is ready on return. Otherwise only the pixels
+    // are kept, the texture is created and uploaded when the next frame starts.
     void update_image(const cv::Mat &image);
 
-    struct nk_image nuklear_image;
-    gl::GLuint texture_id;
+    // Texture memory including mipmaps and tiles, none while evicted.
+    size_t texture_bytes() const;
+    // Moves the texture to a CPU copy to free GPU memory, restore_texture() uploads it again,
+    // as well as pixels of an update not uploaded yet; with evicted false only the latter.
+    // The image content does not change, so both work on const images.
+    void evict_texture() const;
+    void restore_texture(bool evicted = true) const;
+    bool resident() const;
+
+    // For per-window GPU memory accounting: the key is the shared texture, so images with
+    // the same content are counted once. The evictor keeps textures other images hold, or
+    // another window drew last within a second, they would only be uploaded again. It
+    // returns whether the texture was evicted. Windows are identified by any stable key.
+    const void *texture_key() const;
+    void texture_drawn(const void *window) const;
+    std::function<bool()> texture_evictor(const void *window) const;
+
+    // Identifies the texture content, 0 for none. Caches derived from the texture compare it
+    // instead of texture_id, as names are reused by GL after textures are deleted.
+    uint64_t texture_version() const;
+
+    // Images larger than the texture cap keep their texture as a scaled-down overview and
+    // their full resolution on the CPU, drawn zoomed-in from tiles that are uploaded when
+    // first needed and released least recently used first.
+    bool tiled() const;
+    // Tiles covering the region [lo, hi) of the image, in pixels, when drawn screen_width
+    // pixels wide. They come from the coarsest level with a texel per screen pixel; none
+    // are returned when the overview texture is fine enough.
+    void tiles(const Eigen::Vector2f &lo, const Eigen::Vector2f &hi, float screen_width, std::vector<ImageTile> &tiles) const;
+
+    // Refreshed by restore_texture() when the texture gets its name late, after an update
+    // without a context or the end of the share group it lived in.
+    mutable struct nk_image nuklear_image;
+    mutable gl::GLuint texture_id;
     Eigen::Vector2i texture_size;
     Eigen::Vector2i size;
+
+  private:
+    std::shared_ptr<image_texture_t> texture;
 };
 
 } // namespace lightvis
@@ -5,12 +5,26 @@
 #include <memory>
 #include <string>
 #include <Eigen/Eigen>
+#include <lightvis/arena.h>
+#include <lightvis/histogram.h>
 #include <lightvis/image.h>
+#include <lightvis/point_cloud.h>
 #include <lightvis/shader.h>
+#include <lightvis/stats.h>
+#include <lightvis/value.h>
+#include <lightvis/voxel_grid.h>
 
 namespace lightvis {
 
 class LightVisDetail;
+struct record_state_t;
+
+enum class Colormap {
+    Gray,
+    Jet,
+    Viridis,
+    Turbo
+};
 
 struct MouseStates {
     bool mouse_left;
@@ -26,6 +40,31 @@ struct MouseStates {
     Eigen::Vector2f scroll;
 };
 
+// Handle to a record of the scene, returned when it is added. Records belong to a layer,
+// "default" unless moved. Hidden records and records in hidden layers are neither
+// uploaded nor drawn. Handles only refer to the record's state weakly, so handles of
+// removed records, or outliving their LightVis, do nothing. They may be used from any
+// thread, changes take effect with the next frame.
+class Record {
+    friend class LightVisDetail;
+
+  public:
+    Record() = default;
+
+    void remove();
+    void hide();
+    void show();
+    bool visible() const;
+    void set_layer(const std::string &layer);
+
+  private:
+    Record(std::weak_ptr<record_state_t> state) :
+        state(std::move(state)) {
+    }
+
+    std::weak_ptr<record_state_t> state;
+};
+
 class LightVis {
     friend class LightVisDetail;
 
@@ -43,24 +82,100 @@ class LightVis {
     Eigen::Vector3f &location();
     const float &scale() const;
     float &scale();
+    const Eigen::Vector3f &ypr() const;
+    Eigen::Vector3f &ypr();
+    const float &distance() const;
+    float &distance();
 
     Eigen::Matrix4f projection_matrix(float f = 1.0, float near = 1.0e-2, float far = 1.0e4);
     Eigen::Matrix4f view_matrix();
     Eigen::Matrix4f model_matrix();
     Shader *shader();
 
-    void add_points(std::vector<Eigen::Vector3f> &points, Eigen::Vector4f &color);
-    void add_points(std::vector<Eigen::Vector3f> &points, std::vector<Eigen::Vector4f> &colors);
+    Record add_points(std::vector<Eigen::Vector3f> &points, Eigen::Vector4f &color);
+    Record add_points(std::vector<Eigen::Vector3f> &points, std::vector<Eigen::Vector4f> &colors);
+    // Colors each point by its scalar mapped through the colormap, values outside range are clamped.
+    // The mapping runs on the GPU, so changing range is a uniform and changed scalars upload only
+    // the span that differs. Points are append-only, like timed trajectories.
+    Record add_points(std::vector<Eigen::Vector3f> &points, std::vector<float> &scalars, Eigen::Vector2f &range, Colormap colormap = Colormap::Turbo);
 
-    void add_trajectory(std::vector<Eigen::Vector3f> &positions, Eigen::Vector4f &color);
-    void add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors);
+    Record add_trajectory(std::vector<Eigen::Vector3f> &positions, Eigen::Vector4f &color);
+    Record add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors);
+    // Draws the part of a growing trajectory whose ascending timestamps fall in window (first, last).
+    // Only appended positions are uploaded, moving the window costs no upload.
+    Record add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<double> &timestamps, Eigen::Vector2d &window, Eigen::Vector4f &color);
+
+    // Draws the sigma-scaled covariance ellipsoid around each mean, instanced from one sphere mesh.
+    Record add_ellipsoids(std::vector<Eigen::Vector3f> &means, std::vector<Eigen::Matrix3f> &covariances, Eigen::Vector4f &color, float sigma = 1.0f);
+    Record add_ellipsoids(std::vector<Eigen::Vector3f> &means, std::vector<Eigen::Matrix3f> &covariances, std::vector<Eigen::Vector4f> &colors, float sigma = 1.0f);
+
+    // Draws each text at its position at a fixed pixel size, all glyphs in one instanced draw.
+    // Labels overlapping a nearer one on screen are left out.
+    Record add_labels(std::vector<Eigen::Vector3f> &positions, std::vector<std::string> &labels, Eigen::Vector4f &color, float size = 16.0f);
+
+    // Draws each image on a plane at depth in front of its camera pose (camera to world, z forward)
+    // with the frustum edges in color. intrinsics are (fx, fy, cx, cy) in image pixels. Images are
+    // kept as thumbnails in one texture array and all planes drawn instanced.
+    Record add_image_planes(std::vector<const Image *> &images, std::vector<Eigen::Matrix4f> &poses, Eigen::Vector4f &intrinsics, Eigen::Vector4f &color, float depth = 0.5f);
+
+    // Draws a memory-mapped cloud chunk by chunk with frustum culling and level of detail.
+    Record add_point_cloud(const PointCloud *cloud);
+
+    // Draws the occupied voxels as instanced cubes, brick by brick with frustum culling.
+    // Only bricks edited since the last frame are uploaded again.
+    Record add_voxels(const VoxelGrid *grid);
+
+    // Visibility of a layer of records, layers are visible unless hidden here or in the panel.
+    bool &layer_visible(const std::string &layer);
+
+    // Loads a point file or .lvpc cloud on a worker thread and shows it while it arrives,
+    // coarse levels first for clouds. A progress bar is added to the panel.
+    void load_async(const std::string &path);
+
+    // Returns an nk_user_font * of the given height for use in gui(), crisp on HiDPI
+    // framebuffers. Valid while the window is shown.
+    void *font(float size);
+
+    // Counters of the last presented frame, show_stats() toggles an overlay with them.
+    const Stats &stats() const;
+    bool &show_stats();
+
+    // GPU memory the window may hold. Above it the least recently drawn cloud chunks and
+    // images are released back to the mapped file or a CPU copy, and uploaded again when drawn.
+    size_t &memory_budget();
+
+    // Scratch memory for draw() and gui() overrides, released after the frame is presented.
+    Arena &frame_arena();
 
     void add_separator();
+    // A checkbox per layer of records, toggling layer_visible().
+    void add_layer_toggles();
     void add_label(const std::string &label);
     void add_image(const Image *image);
     void add_graph(const std::vector<double> &values);
     void add_progress(const double &value);
 
+    // Owning variants: the widget keeps the data, update it through the returned
+    // value from any thread with set(std::move(...)) instead of locking a shared copy.
+    std::shared_ptr<Value<std::string>> add_label(std::string &&label);
+    std::shared_ptr<Value<std::vector<double>>> add_graph(std::vector<double> &&values);
+    std::shared_ptr<Value<double>> add_progress(double &&value);
+
+    // Histogram of samples in [lo, hi), push() them from one producer thread.
+    std::shared_ptr<Histogram> add_histogram(double lo, double hi, size_t bins = 64);
+
+    // Renders one frame into a hidden window and reads it back as BGR.
+    // Works without a running main(), e.g. for batch rendering. Without a display it
+    // renders through OSMesa on GLFW's null platform (GLFW 3.4 and libOSMesa needed).
+    bool capture(cv::Mat &image);
+    // Same as capture() without reading the frame back, the context stays current afterwards.
+    bool render();
+
+    // Streams every rendered frame into a compressed video (.avi: MJPG, otherwise mp4v).
+    // Readback is asynchronous and encoding runs on a worker thread.
+    void start_recording(const std::string &path, double fps = 30.0);
+    void stop_recording();
+
   protected:
     virtual void load();
     virtual void unload();
@@ -0,0 +1,101 @@
+#ifndef LIGHTVIS_POINT_CLOUD_H
+#define LIGHTVIS_POINT_CLOUD_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+#include <Eigen/Eigen>
+
+#define LIGHTVIS_POINT_CLOUD_MAX_LEVELS 8
+
+namespace lightvis {
+
+// On-disk layout of .lvpc files (little endian, every section 16-byte aligned):
+//   header | chunk table | positions (float x, y, z) | colors (uint8 r, g, b, a)
+// Points are grouped into spatially coherent chunks; inside a chunk they are
+// ordered coarse to fine, so level l is the prefix of level_counts[l] points.
+struct PointCloudHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t point_count;
+    std::uint32_t chunk_count;
+    std::uint32_t level_count;
+    std::uint64_t chunks_offset;
+    std::uint64_t positions_offset;
+    std::uint64_t colors_offset;
+};
+
+struct PointCloudChunk {
+    float aabb_min[3];
+    float aabb_max[3];
+    std::uint64_t first;
+    std::uint32_t level_counts[LIGHTVIS_POINT_CLOUD_MAX_LEVELS];
+};
+
+// Read-only memory mapping of a .lvpc file. Columns are used in place, so
+// opening costs no parsing and chunks can be uploaded straight from the mapping.
+class PointCloud {
+  public:
+    PointCloud();
+    ~PointCloud();
+
+    bool open(const std::string &path);
+    void close();
+
+    bool empty() const {
+        return header == nullptr || header->point_count == 0;
+    }
+
+    size_t size() const {
+        return header ? header->point_count : 0;
+    }
+
+    size_t level_count() const {
+        return header ? header->level_count : 0;
+    }
+
+    size_t chunk_count() const {
+        return header ? header->chunk_count : 0;
+    }
+
+    const PointCloudChunk &chunk(size_t i) const {
+        return chunks[i];
+    }
+
+    const float *positions(const PointCloudChunk &chunk) const {
+        return positions_data + chunk.first * 3;
+    }
+
+    const std::uint8_t *colors(const PointCloudChunk &chunk) const {
+        return colors_data + chunk.first * 4;
+    }
+
+    // Touches the pages of points [begin, end) of a chunk so later reads do not fault.
+    void prefetch(const PointCloudChunk &chunk, size_t begin, size_t end) const;
+
+  private:
+    const PointCloudHeader *header = nullptr;
+    const PointCloudChunk *chunks = nullptr;
+    const float *positions_data = nullptr;
+    const std::uint8_t *colors_data = nullptr;
+
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+#ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#endif
+};
+
+// Reads up to max_count points of a text point file, one "x y z [r g b [a]]" line per point
+// with colors in [0, 1]. Returns the number of points read.
+size_t read_points(std::istream &stream, std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors, const Eigen::Vector4f &default_color, size_t max_count = std::numeric_limits<size_t>::max());
+
+// Chunks the points spatially, builds the LOD ordering and writes a .lvpc file.
+bool write_point_cloud(const std::string &path, const std::vector<Eigen::Vector3f> &positions, const std::vector<Eigen::Vector4f> &colors, size_t chunk_size = 65536, size_t level_count = 6);
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_POINT_CLOUD_H
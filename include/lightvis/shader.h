@@ -1,8 +1,10 @@
 #ifndef LIGHTVIS_SHADER_H
 #define LIGHTVIS_SHADER_H
 
+#include <type_traits>
 #include <Eigen/Eigen>
 #include <glbinding/gl/gl.h>
+#include <lightvis/stats.h>
 
 namespace lightvis {
 
@@ -151,6 +153,11 @@ class Shader {
         gl::glUniform1f(uni, value);
     }
 
+    void set_uniform(const std::string &name, const Eigen::Vector2f &vector) {
+        gl::GLint uni = uniform(name);
+        gl::glUniform2fv(uni, 1, vector.data());
+    }
+
     void set_uniform(const std::string &name, const Eigen::Vector3f &vector) {
         gl::GLint uni = uniform(name);
         gl::glUniform3fv(uni, 1, vector.data());
@@ -166,36 +173,96 @@ class Shader {
         gl::glUniformMatrix4fv(uni, 1, gl::GL_FALSE, matrix.data());
     }
 
-    template <typename E, int N>
-    void set_attribute(const std::string &name, const std::vector<Eigen::Matrix<E, N, 1>> &data) {
+    // Points a sampler at a texture unit, GL_TEXTURE0 + unit.
+    void set_sampler(const std::string &name, int unit) {
+        gl::GLint uni = uniform(name);
+        gl::glUniform1i(uni, unit);
+    }
+
+    template <typename E, int N, typename Allocator>
+    void set_attribute(const std::string &name, const std::vector<Eigen::Matrix<E, N, 1>, Allocator> &data) {
+        upload_attribute(name, data.data(), get_type_enum<E>(), is_type_integral<E>(), N, sizeof(E) * N * data.size());
+    }
+
+    template <typename E, typename Allocator, typename = std::enable_if_t<std::is_arithmetic_v<E>>>
+    void set_attribute(const std::string &name, const std::vector<E, Allocator> &data) {
+        upload_attribute(name, data.data(), get_type_enum<E>(), is_type_integral<E>(), 1, sizeof(E) * data.size());
+    }
+
+    // Points the attribute at a buffer owned by the caller, e.g. one uploaded once and drawn many times.
+    void set_attribute(const std::string &name, gl::GLuint buffer, gl::GLint size, gl::GLenum type, gl::GLboolean normalized, gl::GLsizei stride = 0, size_t offset = 0) {
         gl::GLint attrib = attribute(name);
-        if (attribute_buffers.count(attrib) == 0) {
-            gl::GLuint buffer;
-            gl::glGenBuffers(1, &buffer);
-            attribute_buffers[attrib] = buffer;
-        }
-        gl::GLuint buffer = attribute_buffers.at(attrib);
         gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
-        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(E) * N * data.size(), &data[0], gl::GL_DYNAMIC_DRAW);
         gl::glEnableVertexAttribArray(attrib);
-        gl::glVertexAttribPointer(attrib, N, get_type_enum<E>(), is_type_integral<E>(), 0, nullptr);
+        gl::glVertexAttribPointer(attrib, size, type, normalized, stride, (const void *)offset);
         gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
     }
 
+    // Feeds the same value to every vertex instead of reading a buffer.
+    void set_attribute(const std::string &name, const Eigen::Vector4f &value) {
+        gl::GLint attrib = attribute(name);
+        gl::glDisableVertexAttribArray(attrib);
+        gl::glVertexAttrib4fv(attrib, value.data());
+    }
+
+    // Advances the attribute once per divisor instances instead of once per vertex.
+    void set_divisor(const std::string &name, gl::GLuint divisor) {
+        gl::glVertexAttribDivisor(attribute(name), divisor);
+    }
+
     void set_indices(const std::vector<unsigned int> &indices) {
         gl::glBindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, index_buffer);
         gl::glBufferData(gl::GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], gl::GL_DYNAMIC_DRAW);
+        index_bytes = sizeof(unsigned int) * indices.size();
+        frame_counters().upload(index_bytes);
+    }
+
+    size_t buffer_count() const {
+        return attribute_buffers.size() + 1;
+    }
+
+    // Size of the buffers owned by the shader, external attribute buffers are not counted.
+    size_t buffer_bytes() const {
+        size_t bytes = index_bytes;
+        for (auto [attrib, size] : attribute_bytes) {
+            bytes += size;
+        }
+        return bytes;
     }
 
     void draw(gl::GLenum mode, gl::GLuint start, gl::GLuint count) {
         gl::glDrawArrays(mode, start, count);
+        frame_counters().draw(count);
     }
 
     void draw_indexed(gl::GLenum mode, gl::GLuint start, gl::GLuint count) {
         gl::glDrawElements(mode, count, gl::GL_UNSIGNED_INT, (const void *)(start * sizeof(gl::GLuint)));
+        frame_counters().draw(count);
+    }
+
+    void draw_indexed_instanced(gl::GLenum mode, gl::GLuint start, gl::GLuint count, gl::GLuint instances) {
+        gl::glDrawElementsInstanced(mode, count, gl::GL_UNSIGNED_INT, (const void *)(start * sizeof(gl::GLuint)), instances);
+        frame_counters().draw(size_t(count) * instances);
     }
 
   private:
+    void upload_attribute(const std::string &name, const void *data, gl::GLenum type, gl::GLboolean integral, gl::GLint size, size_t bytes) {
+        gl::GLint attrib = attribute(name);
+        if (attribute_buffers.count(attrib) == 0) {
+            gl::GLuint buffer;
+            gl::glGenBuffers(1, &buffer);
+            attribute_buffers[attrib] = buffer;
+        }
+        gl::GLuint buffer = attribute_buffers.at(attrib);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, bytes, data, gl::GL_DYNAMIC_DRAW);
+        attribute_bytes[attrib] = bytes;
+        frame_counters().upload(bytes);
+        gl::glEnableVertexAttribArray(attrib);
+        gl::glVertexAttribPointer(attrib, size, type, integral, 0, nullptr);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+    }
+
     gl::GLint uniform(const std::string &name) {
         if (uniforms.count(name) == 0) {
             gl::GLint location = gl::glGetUniformLocation(program, name.c_str());
@@ -226,7 +293,9 @@ class Shader {
     std::map<std::string, gl::GLint> uniforms;
     std::map<std::string, gl::GLint> attributes;
     std::map<gl::GLint, gl::GLuint> attribute_buffers;
+    std::map<gl::GLint, size_t> attribute_bytes;
     gl::GLuint index_buffer;
+    size_t index_bytes = 0;
     gl::GLuint vertex_array;
 };
 
@@ -0,0 +1,47 @@
+#ifndef LIGHTVIS_STATS_H
+#define LIGHTVIS_STATS_H
+
+#include <cstddef>
+
+namespace lightvis {
+
+struct Stats {
+    size_t draw_calls = 0;         // draw calls issued during the last frame, GUI included
+    size_t vertices = 0;           // vertices or indices submitted by those draw calls
+    size_t uploaded_bytes = 0;     // bytes sent to buffers and textures during the last frame
+    size_t gui_bytes = 0;          // live nuklear allocations
+    size_t gui_peak_bytes = 0;     // high-water mark of gui_bytes
+    size_t gui_reserved_bytes = 0; // held by the GUI pool, including free blocks
+    size_t gui_allocations = 0;    // nuklear allocations during the last frame
+    size_t gpu_buffers = 0;        // buffer objects held by the window's GL context
+    size_t gpu_textures = 0;       // texture and renderbuffer objects held by the window's GL context
+    size_t gpu_buffer_bytes = 0;   // memory of those buffers
+    size_t gpu_texture_bytes = 0;  // memory of those textures and renderbuffers
+    size_t gpu_evictions = 0;      // resources released by the memory budget so far
+};
+
+// GL activity since the last presented frame. Shader, Image and the window's own
+// drawing add to it on the rendering thread, each window moves it into its Stats
+// when presenting, so work done by draw() and gui() overrides is counted as well.
+struct FrameCounters {
+    size_t draw_calls = 0;
+    size_t vertices = 0;
+    size_t uploaded_bytes = 0;
+
+    void draw(size_t count) {
+        draw_calls++;
+        vertices += count;
+    }
+    void upload(size_t bytes) {
+        uploaded_bytes += bytes;
+    }
+};
+
+inline FrameCounters &frame_counters() {
+    static thread_local FrameCounters s_counters;
+    return s_counters;
+}
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_STATS_H
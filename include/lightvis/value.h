@@ -0,0 +1,55 @@
+#ifndef LIGHTVIS_VALUE_H
+#define LIGHTVIS_VALUE_H
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace lightvis {
+
+// A value owned by lightvis and replaced by other threads while the window draws it.
+// set() swaps the new value in under a short lock and get(), called when drawing,
+// swaps it to the front, so updates move data instead of copying it and nobody has
+// to keep a long-lived copy alive. The previous value is handed back through set()'s
+// argument and released by the caller outside the lock.
+template <typename T>
+class Value {
+  public:
+    Value() = default;
+    explicit Value(T &&value) :
+        front(std::move(value)) {
+    }
+    Value(const Value &) = delete;
+    Value &operator=(const Value &) = delete;
+
+    void set(T &&value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(back, value);
+        updated = true;
+    }
+
+    void set(const T &value) {
+        T copy(value);
+        set(std::move(copy));
+    }
+
+    // Only for the drawing thread.
+    const T &get() {
+        if (updated.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(front, back);
+            updated = false;
+        }
+        return front;
+    }
+
+  private:
+    std::mutex mutex;
+    std::atomic<bool> updated = false;
+    T front = {};
+    T back = {};
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_VALUE_H
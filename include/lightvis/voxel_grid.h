@@ -0,0 +1,56 @@
+#ifndef LIGHTVIS_VOXEL_GRID_H
+#define LIGHTVIS_VOXEL_GRID_H
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <Eigen/Eigen>
+
+namespace lightvis {
+
+// Sparse occupancy grid stored as hashed bricks of 8x8x8 voxels. Every edit stamps
+// its brick with a new version, so the renderer re-uploads only the bricks that
+// changed since the last frame. Like the vectors given to add_points(), the grid
+// must not be edited while a window is drawing it.
+class VoxelGrid {
+  public:
+    static constexpr int brick_size = 8;
+    static constexpr int brick_volume = brick_size * brick_size * brick_size;
+
+    struct Brick {
+        Eigen::Vector3i origin;                    // first cell of the brick
+        std::array<std::uint32_t, brick_volume> voxels; // RGBA8 in memory order, 0 when free
+        std::uint32_t occupied = 0;
+        std::uint64_t version = 0;
+    };
+
+    VoxelGrid(float voxel_size = 0.1f) :
+        size(voxel_size) {
+    }
+
+    float voxel_size() const {
+        return size;
+    }
+
+    void set(const Eigen::Vector3i &cell, const Eigen::Vector4f &color);
+    void reset(const Eigen::Vector3i &cell);
+    bool occupied(const Eigen::Vector3i &cell) const;
+    void clear();
+
+    const std::unordered_map<std::uint64_t, Brick> &bricks() const {
+        return brick_map;
+    }
+
+  private:
+    static std::uint64_t brick_key(const Eigen::Vector3i &brick);
+    static Eigen::Vector3i brick_of(const Eigen::Vector3i &cell);
+    static int voxel_index(const Eigen::Vector3i &cell);
+
+    float size;
+    std::unordered_map<std::uint64_t, Brick> brick_map;
+    std::uint64_t version = 0;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_VOXEL_GRID_H
@@ -0,0 +1,54 @@
+#include <lightvis/arena.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace lightvis {
+
+Arena::Arena(size_t block_size) :
+    block_size(block_size) {
+}
+
+Arena::~Arena() = default;
+
+void *Arena::allocate(size_t size, size_t alignment) {
+    while (current < blocks.size()) {
+        block_t &block = blocks[current];
+        uintptr_t base = (uintptr_t)block.data.get();
+        size_t begin = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (begin + size <= block.size) {
+            offset = begin + size;
+            used_size += size;
+            return block.data.get() + begin;
+        }
+        current++;
+        offset = 0;
+    }
+    size_t new_size = std::max(block_size, size + alignment);
+    blocks.push_back({std::make_unique<unsigned char[]>(new_size), new_size});
+    current = blocks.size() - 1;
+    offset = 0;
+    return allocate(size, alignment);
+}
+
+void Arena::reset() {
+    // Frames that overflowed into several blocks are merged into one,
+    // so the next frame of the same size fits without allocating.
+    if (blocks.size() > 1) {
+        size_t total_size = capacity();
+        blocks.clear();
+        blocks.push_back({std::make_unique<unsigned char[]>(total_size), total_size});
+    }
+    current = 0;
+    offset = 0;
+    used_size = 0;
+}
+
+size_t Arena::capacity() const {
+    size_t total_size = 0;
+    for (const auto &block : blocks) {
+        total_size += block.size;
+    }
+    return total_size;
+}
+
+} // namespace lightvis
@@ -0,0 +1,227 @@
+#include <lightvis/font.h>
+#include <lightvis/pool.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#ifdef LIGHTVIS_PREBAKED_FONT
+namespace lightvis {
+size_t prebaked_font_atlas_count();
+const font_atlas_t *prebaked_font_atlas(size_t i);
+} // namespace lightvis
+#else
+#include <lightvis/lightvis_font_roboto.h>
+#endif
+
+namespace lightvis {
+
+const font_glyph_t *font_atlas_t::find_glyph(nk_rune codepoint) const {
+    size_t index = 0;
+    for (const nk_rune *range = ranges; range[0] && range[1]; range += 2) {
+        if (codepoint >= range[0] && codepoint <= range[1]) {
+            return &glyphs[index + (codepoint - range[0])];
+        }
+        index += range[1] - range[0] + 1;
+    }
+    return nullptr;
+}
+
+static const font_glyph_t *find_glyph_or_fallback(const font_atlas_t *atlas, nk_rune codepoint) {
+    if (const font_glyph_t *glyph = atlas->find_glyph(codepoint)) return glyph;
+    if (const font_glyph_t *glyph = atlas->find_glyph('?')) return glyph;
+    return &atlas->glyphs[0];
+}
+
+bool bake_font_atlas(const void *ttf, size_t ttf_size, float size, font_atlas_storage_t &atlas) {
+    pool_allocator_t pool;
+    nk_allocator allocator = pool.nuklear();
+    struct nk_font_atlas baker;
+    nk_font_atlas_init(&baker, &allocator);
+    nk_font_atlas_begin(&baker);
+    struct nk_font *font = nk_font_atlas_add_from_memory(&baker, const_cast<void *>(ttf), ttf_size, size, nullptr);
+    int width, height;
+    const auto *pixels = (const unsigned char *)nk_font_atlas_bake(&baker, &width, &height, NK_FONT_ATLAS_ALPHA8);
+    if (!font || !pixels) {
+        nk_font_atlas_clear(&baker);
+        return false;
+    }
+
+    atlas.alpha_storage.assign(pixels, pixels + size_t(width) * size_t(height));
+    atlas.range_storage.clear();
+    atlas.glyph_storage.clear();
+    for (const nk_rune *range = nk_font_default_glyph_ranges(); range[0] && range[1]; range += 2) {
+        atlas.range_storage.push_back(range[0]);
+        atlas.range_storage.push_back(range[1]);
+        for (nk_rune codepoint = range[0]; codepoint <= range[1]; ++codepoint) {
+            const struct nk_font_glyph *g = nk_font_find_glyph(font, codepoint);
+            atlas.glyph_storage.push_back({codepoint, g->xadvance, g->x0, g->y0, g->x1, g->y1, g->u0, g->v0, g->u1, g->v1});
+        }
+    }
+    atlas.range_storage.push_back(0);
+
+    struct nk_draw_null_texture null_texture;
+    nk_font_atlas_end(&baker, nk_handle_id(0), &null_texture);
+    nk_font_atlas_clear(&baker);
+
+    atlas.size = size;
+    atlas.width = width;
+    atlas.height = height;
+    atlas.alpha = atlas.alpha_storage.data();
+    atlas.alpha_rle = nullptr;
+    atlas.alpha_rle_size = 0;
+    atlas.ranges = atlas.range_storage.data();
+    atlas.glyphs = atlas.glyph_storage.data();
+    atlas.glyph_count = atlas.glyph_storage.size();
+    atlas.null_uv[0] = null_texture.uv.x;
+    atlas.null_uv[1] = null_texture.uv.y;
+    return true;
+}
+
+static void encode_alpha(const font_atlas_t &atlas, std::vector<unsigned char> &rle) {
+    size_t pixel_count = size_t(atlas.width) * size_t(atlas.height);
+    for (size_t i = 0; i < pixel_count;) {
+        if (atlas.alpha[i] != 0) {
+            rle.push_back(atlas.alpha[i++]);
+            continue;
+        }
+        unsigned char run = 0;
+        while (i < pixel_count && atlas.alpha[i] == 0 && run < 255) {
+            run++;
+            i++;
+        }
+        rle.push_back(0);
+        rle.push_back(run);
+    }
+}
+
+static void decode_alpha(const font_atlas_t &atlas, std::vector<unsigned char> &alpha) {
+    alpha.clear();
+    alpha.reserve(size_t(atlas.width) * size_t(atlas.height));
+    for (size_t i = 0; i < atlas.alpha_rle_size; ++i) {
+        if (atlas.alpha_rle[i] != 0) {
+            alpha.push_back(atlas.alpha_rle[i]);
+        } else if (i + 1 < atlas.alpha_rle_size) {
+            alpha.insert(alpha.end(), atlas.alpha_rle[++i], 0);
+        }
+    }
+    alpha.resize(size_t(atlas.width) * size_t(atlas.height), 0);
+}
+
+bool write_font_atlas_source(const std::string &path, const std::vector<font_atlas_storage_t> &atlases) {
+    std::ofstream file(path);
+    if (!file) return false;
+    char buffer[256];
+    file << "//\n// Generated by lightvis_fontbake, do not edit.\n//\n";
+    file << "#include <lightvis/font.h>\n\nnamespace lightvis {\n";
+    for (size_t k = 0; k < atlases.size(); ++k) {
+        const font_atlas_t &atlas = atlases[k];
+        std::vector<unsigned char> rle;
+        encode_alpha(atlas, rle);
+        file << "\nstatic const unsigned char font_alpha_rle_" << k << "[] = {";
+        for (size_t i = 0; i < rle.size(); ++i) {
+            file << ((i % 32 == 0) ? "\n    " : " ") << int(rle[i]) << ",";
+        }
+        file << "\n};\n\nstatic const nk_rune font_ranges_" << k << "[] = {";
+        for (const nk_rune *range = atlas.ranges; range[0] && range[1]; range += 2) {
+            file << "0x" << std::hex << range[0] << ", 0x" << range[1] << std::dec << ", ";
+        }
+        file << "0};\n\nstatic const font_glyph_t font_glyphs_" << k << "[] = {\n";
+        for (size_t i = 0; i < atlas.glyph_count; ++i) {
+            const font_glyph_t &g = atlas.glyphs[i];
+            snprintf(buffer, sizeof(buffer), "    {%u, %#.9gf, %#.9gf, %#.9gf, %#.9gf, %#.9gf, %#.9gf, %#.9gf, %#.9gf, %#.9gf},\n", g.codepoint, g.xadvance, g.x0, g.y0, g.x1, g.y1, g.u0, g.v0, g.u1, g.v1);
+            file << buffer;
+        }
+        file << "};\n";
+    }
+    file << "\nstatic const font_atlas_t font_atlases[] = {\n";
+    for (size_t k = 0; k < atlases.size(); ++k) {
+        const font_atlas_t &atlas = atlases[k];
+        snprintf(buffer, sizeof(buffer), "    {%#.9gf, %d, %d, nullptr, font_alpha_rle_%zu, sizeof(font_alpha_rle_%zu), font_ranges_%zu, font_glyphs_%zu, %zu, {%#.9gf, %#.9gf}},\n", atlas.size, atlas.width, atlas.height, k, k, k, k, atlas.glyph_count, atlas.null_uv[0], atlas.null_uv[1]);
+        file << buffer;
+    }
+    file << "};\n\n";
+    file << "size_t prebaked_font_atlas_count() {\n    return sizeof(font_atlases) / sizeof(font_atlas_t);\n}\n\n";
+    file << "const font_atlas_t *prebaked_font_atlas(size_t i) {\n    return &font_atlases[i];\n}\n\n";
+    file << "} // namespace lightvis\n";
+    return bool(file);
+}
+
+const font_atlas_t *find_font_atlas(float pixel_size) {
+    static std::mutex s_mutex;
+    static std::map<int, std::unique_ptr<font_atlas_storage_t>> s_atlases;
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+#ifdef LIGHTVIS_PREBAKED_FONT
+    const font_atlas_t *source = nullptr;
+    for (size_t i = 0; i < prebaked_font_atlas_count(); ++i) {
+        const font_atlas_t *candidate = prebaked_font_atlas(i);
+        if (!source) {
+            source = candidate;
+        } else if (source->size < pixel_size) {
+            if (candidate->size > source->size) source = candidate;
+        } else if (candidate->size >= pixel_size && candidate->size < source->size) {
+            source = candidate;
+        }
+    }
+    if (!source) return nullptr;
+    int key = (int)source->size;
+#else
+    int key = std::max(1, (int)std::lround(pixel_size));
+#endif
+
+    auto &atlas = s_atlases[key];
+    if (!atlas) {
+        atlas = std::make_unique<font_atlas_storage_t>();
+#ifdef LIGHTVIS_PREBAKED_FONT
+        *(font_atlas_t *)atlas.get() = *source;
+        decode_alpha(*source, atlas->alpha_storage);
+        atlas->alpha = atlas->alpha_storage.data();
+#else
+        if (!bake_font_atlas(Roboto_Regular_ttf, Roboto_Regular_ttf_len, (float)key, *atlas)) {
+            s_atlases.erase(key);
+            return nullptr;
+        }
+#endif
+    }
+    return atlas.get();
+}
+
+static float font_text_width(nk_handle handle, float height, const char *text, int len) {
+    const auto *atlas = (const font_atlas_t *)handle.ptr;
+    float width = 0;
+    int offset = 0;
+    while (offset < len) {
+        nk_rune codepoint;
+        int glyph_len = nk_utf_decode(text + offset, &codepoint, len - offset);
+        if (glyph_len == 0 || codepoint == NK_UTF_INVALID) break;
+        width += find_glyph_or_fallback(atlas, codepoint)->xadvance;
+        offset += glyph_len;
+    }
+    return width * height / atlas->size;
+}
+
+static void font_query_glyph(nk_handle handle, float height, struct nk_user_font_glyph *glyph, nk_rune codepoint, nk_rune next_codepoint) {
+    const auto *atlas = (const font_atlas_t *)handle.ptr;
+    const font_glyph_t *g = find_glyph_or_fallback(atlas, codepoint);
+    float scale = height / atlas->size;
+    glyph->width = (g->x1 - g->x0) * scale;
+    glyph->height = (g->y1 - g->y0) * scale;
+    glyph->offset = nk_vec2(g->x0 * scale, g->y0 * scale);
+    glyph->xadvance = g->xadvance * scale;
+    glyph->uv[0] = nk_vec2(g->u0, g->v0);
+    glyph->uv[1] = nk_vec2(g->u1, g->v1);
+}
+
+void init_user_font(struct nk_user_font *font, const font_atlas_t *atlas, float height, nk_handle texture) {
+    font->userdata = nk_handle_ptr((void *)atlas);
+    font->height = height;
+    font->width = font_text_width;
+    font->query = font_query_glyph;
+    font->texture = texture;
+}
+
+} // namespace lightvis
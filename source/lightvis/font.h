@@ -0,0 +1,62 @@
+#ifndef LIGHTVIS_FONT_H
+#define LIGHTVIS_FONT_H
+
+#include <string>
+#include <vector>
+#include <nuklear.h>
+
+#define LIGHTVIS_FONT_SIZE 16
+
+namespace lightvis {
+
+struct font_glyph_t {
+    nk_rune codepoint;
+    float xadvance;
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+};
+
+// A font baked at a pixel size: glyph metrics for the codepoint ranges plus the
+// coverage bitmap. Glyphs are stored in range order; ranges are (first, last)
+// pairs ending with 0. Atlases baked at build time carry the bitmap run-length
+// encoded in alpha_rle (a zero byte is followed by its run length) and alpha is
+// only filled once they are decoded.
+struct font_atlas_t {
+    float size;
+    int width;
+    int height;
+    const unsigned char *alpha;
+    const unsigned char *alpha_rle;
+    size_t alpha_rle_size;
+    const nk_rune *ranges;
+    const font_glyph_t *glyphs;
+    size_t glyph_count;
+    float null_uv[2];
+
+    const font_glyph_t *find_glyph(nk_rune codepoint) const;
+};
+
+struct font_atlas_storage_t : public font_atlas_t {
+    std::vector<unsigned char> alpha_storage;
+    std::vector<nk_rune> range_storage;
+    std::vector<font_glyph_t> glyph_storage;
+};
+
+// Rasterizes a TTF with nuklear's baker, used at build time by lightvis_fontbake.
+bool bake_font_atlas(const void *ttf, size_t ttf_size, float size, font_atlas_storage_t &atlas);
+bool write_font_atlas_source(const std::string &path, const std::vector<font_atlas_storage_t> &atlases);
+
+// Returns the atlas for a pixel size, shared by all windows. Build-time atlases are
+// decoded on first use and the closest one not smaller than the request is picked;
+// when LIGHTVIS_PREBAKED_FONT is off the embedded TTF is baked at that size on first use.
+// Safe to call from any thread.
+const font_atlas_t *find_font_atlas(float pixel_size);
+
+// Fills a nuklear font of the given height whose glyphs come from the atlas,
+// drawn with the given texture. The atlas may be baked at a larger pixel size
+// for HiDPI framebuffers, glyph quads are scaled back to the font height.
+void init_user_font(struct nk_user_font *font, const font_atlas_t *atlas, float height, nk_handle texture);
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_FONT_H
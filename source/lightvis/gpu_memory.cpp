@@ -0,0 +1,66 @@
+#include <lightvis/gpu_memory.h>
+
+namespace lightvis {
+
+void gpu_memory_t::track(const void *key, kind_t kind, size_t bytes, size_t objects, evict_t evict) {
+    auto it = lookup.find(key);
+    if (it != lookup.end()) {
+        entry_t &entry = *it->second;
+        kind_bytes[entry.kind] -= entry.bytes;
+        kind_objects[entry.kind] -= entry.objects;
+        entry.kind = kind;
+        entry.bytes = bytes;
+        entry.objects = objects;
+        entry.frame = frame;
+        if (evict) entry.evict = std::move(evict);
+        entries.splice(entries.begin(), entries, it->second);
+    } else {
+        entries.push_front({key, kind, bytes, objects, frame, std::move(evict)});
+        lookup[key] = entries.begin();
+    }
+    kind_bytes[kind] += bytes;
+    kind_objects[kind] += objects;
+}
+
+void gpu_memory_t::release(const void *key) {
+    auto it = lookup.find(key);
+    if (it == lookup.end()) return;
+    kind_bytes[it->second->kind] -= it->second->bytes;
+    kind_objects[it->second->kind] -= it->second->objects;
+    entries.erase(it->second);
+    lookup.erase(it);
+}
+
+void gpu_memory_t::touch(const void *key) {
+    auto it = lookup.find(key);
+    if (it == lookup.end()) return;
+    it->second->frame = frame;
+    entries.splice(entries.begin(), entries, it->second);
+}
+
+void gpu_memory_t::enforce() {
+    // Entries are ordered by last use, so the scan stops at the first one drawn this frame.
+    auto it = entries.end();
+    while (total_bytes() > budget && it != entries.begin()) {
+        --it;
+        if (it->frame == frame) break;
+        if (!it->evict || !it->evict()) continue;
+        kind_bytes[it->kind] -= it->bytes;
+        kind_objects[it->kind] -= it->objects;
+        lookup.erase(it->key);
+        it = entries.erase(it);
+        evictions++;
+    }
+    frame++;
+}
+
+void gpu_memory_t::clear() {
+    entries.clear();
+    lookup.clear();
+    kind_bytes[buffer] = 0;
+    kind_bytes[texture] = 0;
+    kind_objects[buffer] = 0;
+    kind_objects[texture] = 0;
+}
+
+} // namespace lightvis
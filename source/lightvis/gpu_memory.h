@@ -0,0 +1,71 @@
+#ifndef LIGHTVIS_GPU_MEMORY_H
+#define LIGHTVIS_GPU_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#define LIGHTVIS_GPU_MEMORY_BUDGET (size_t(1) << 30)
+
+namespace lightvis {
+
+// Book-keeping of the buffers and textures a window holds in its GL context.
+// Resources are keyed by their owner and kept in least-recently-drawn order;
+// those registered with an evict function can be released back to their CPU or
+// disk copy when the total exceeds the budget, and are re-uploaded on next use.
+class gpu_memory_t {
+  public:
+    enum kind_t {
+        buffer,
+        texture
+    };
+    // Returns false when the resource has to stay, it is then kept and skipped.
+    using evict_t = std::function<bool()>;
+
+    // Records the size and number of GL objects of a resource, replacing an earlier
+    // record of the same owner. Tracking counts as a use in the current frame.
+    void track(const void *key, kind_t kind, size_t bytes, size_t objects = 1, evict_t evict = nullptr);
+    void release(const void *key);
+    // Marks a resource as drawn in the current frame, it is not evicted before the frame ends.
+    void touch(const void *key);
+
+    // Evicts least recently drawn resources until the total fits the budget,
+    // then starts a new frame.
+    void enforce();
+    void clear();
+
+    size_t bytes(kind_t kind) const {
+        return kind_bytes[kind];
+    }
+    size_t objects(kind_t kind) const {
+        return kind_objects[kind];
+    }
+    size_t total_bytes() const {
+        return kind_bytes[buffer] + kind_bytes[texture];
+    }
+
+    size_t budget = LIGHTVIS_GPU_MEMORY_BUDGET;
+    size_t evictions = 0;
+
+  private:
+    struct entry_t {
+        const void *key;
+        kind_t kind;
+        size_t bytes;
+        size_t objects;
+        uint64_t frame;
+        evict_t evict;
+    };
+
+    std::list<entry_t> entries;
+    std::unordered_map<const void *, std::list<entry_t>::iterator> lookup;
+    size_t kind_bytes[2] = {0, 0};
+    size_t kind_objects[2] = {0, 0};
+    uint64_t frame = 0;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_GPU_MEMORY_H
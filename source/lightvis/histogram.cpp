@@ -0,0 +1,81 @@
+#include <lightvis/histogram.h>
+#include <algorithm>
+#include <Eigen/Eigen>
+
+namespace lightvis {
+
+Histogram::Histogram(double lo, double hi, size_t bins, size_t capacity) :
+    range_lo(lo), range_hi(hi), bins(std::max<size_t>(bins, 1), 0) {
+    inv_width = (hi > lo) ? this->bins.size() / (hi - lo) : 0.0;
+    size_t size = 1;
+    while (size < std::max<size_t>(capacity, 2)) size *= 2;
+    ring.resize(size);
+    mask = size - 1;
+}
+
+bool Histogram::push(double sample) {
+    return push(&sample, 1) == 1;
+}
+
+size_t Histogram::push(const double *samples, size_t count) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t accepted = std::min(count, ring.size() - (h - t));
+    for (size_t i = 0; i < accepted; ++i) {
+        ring[(h + i) & mask] = samples[i];
+    }
+    head.store(h + accepted, std::memory_order_release);
+    if (accepted < count) {
+        drops.fetch_add(count - accepted, std::memory_order_relaxed);
+    }
+    return accepted;
+}
+
+void Histogram::update() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    // The pending samples are at most two contiguous spans of the ring.
+    while (t != h) {
+        size_t begin = t & mask;
+        size_t count = std::min(h - t, ring.size() - begin);
+        bin(ring.data() + begin, count);
+        t += count;
+    }
+    tail.store(t, std::memory_order_release);
+}
+
+void Histogram::clear() {
+    update();
+    std::fill(bins.begin(), bins.end(), 0);
+    below = 0;
+    above = 0;
+    binned = 0;
+}
+
+void Histogram::bin(const double *samples, size_t count) {
+    // Bin indices are computed for a whole batch with Eigen's vectorized array ops,
+    // only the increments are scalar. NaN samples are skipped.
+    constexpr size_t batch = 1024;
+    Eigen::Array<double, Eigen::Dynamic, 1> index(batch);
+    const double last = (double)bins.size();
+    for (size_t offset = 0; offset < count; offset += batch) {
+        size_t n = std::min(batch, count - offset);
+        Eigen::Map<const Eigen::ArrayXd> x(samples + offset, (Eigen::Index)n);
+        index.head(n) = ((x - range_lo) * inv_width).floor().max(-1.0).min(last);
+        for (size_t i = 0; i < n; ++i) {
+            double k = index[i];
+            if (k != k) {
+                continue;
+            } else if (k < 0) {
+                below++;
+            } else if (k >= last) {
+                above++;
+            } else {
+                bins[(size_t)k]++;
+            }
+            binned++;
+        }
+    }
+}
+
+} // namespace lightvis
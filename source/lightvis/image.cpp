@@ -1,32 +1,420 @@
 #include <lightvis/image.h>
+#include <lightvis/stats.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <GLFW/glfw3.h>
+
+#define LIGHTVIS_IMAGE_TEXTURE_CAP 2048
+#define LIGHTVIS_IMAGE_TILE_SIZE 512
+#define LIGHTVIS_IMAGE_TILE_LIMIT 48
+#define LIGHTVIS_IMAGE_SHARED_DRAW_SECONDS 1.0
 
 namespace lightvis {
 
-static unsigned int msb(unsigned int x) {
-    x |= (x >> 1);
-    x |= (x >> 2);
-    x |= (x >> 4);
-    x |= (x >> 8);
-    x |= (x >> 16);
-    return (x & ~(x >> 1));
+// A texture shared by all images with the same content. The cache only holds weak
+// references, the texture is deleted once the last image using it lets go.
+struct image_texture_t {
+    image_texture_t();
+    ~image_texture_t();
+
+    void create();
+    void upload(const cv::Mat &rgb);
+    void set_content(const cv::Mat &image);
+    void uncache();
+    void release_name();
+    void evict();
+
+    uint64_t hash;
+    // Changes with every content, unlike the GL name which is recycled once deleted.
+    uint64_t version = 0;
+    gl::GLuint id = 0;
+    Eigen::Vector2i size;
+    Eigen::Vector2i image_size;
+    int type;
+    // Pixels not on the GPU: set by update_image() without a current context until the
+    // next frame uploads them, and by evict_texture() until the texture is drawn again.
+    cv::Mat pixels;
+    // The pixels are content not uploaded yet, rather than an evicted copy.
+    bool pending = false;
+    // Window that drew the texture last, and when.
+    const void *drawn_by = nullptr;
+    double drawn_at = 0;
+
+    struct tile_t {
+        gl::GLuint id;
+        Eigen::Vector2i size;
+        uint64_t last_used;
+    };
+
+    void release_tiles();
+    size_t tile_bytes() const;
+
+    // RGB levels of a tiled image halving down from the native resolution, the overview
+    // texture stands in for the levels below.
+    std::vector<cv::Mat> pyramid;
+    std::map<std::tuple<int, int, int>, tile_t> tile_cache;
+    uint64_t tile_clock = 0;
+};
+
+static std::unordered_map<uint64_t, std::weak_ptr<image_texture_t>> &texture_cache() {
+    static std::unordered_map<uint64_t, std::weak_ptr<image_texture_t>> s_cache;
+    return s_cache;
+}
+
+static std::unordered_set<image_texture_t *> &live_textures() {
+    static std::unordered_set<image_texture_t *> s_textures;
+    return s_textures;
+}
+
+static std::unordered_set<const Image *> &live_images() {
+    static std::unordered_set<const Image *> s_images;
+    return s_images;
+}
+
+// 64-bit FNV-1a over 8-byte words, rows are hashed separately to skip padding.
+static uint64_t content_hash(const cv::Mat &image) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint64_t word) {
+        hash = (hash ^ word) * 0x100000001b3ull;
+    };
+    mix((uint64_t)image.rows << 32 | (uint32_t)image.cols);
+    mix((uint64_t)image.type());
+    size_t row_bytes = image.cols * image.elemSize();
+    for (int y = 0; y < image.rows; ++y) {
+        const unsigned char *row = image.ptr(y);
+        size_t x = 0;
+        for (; x + 8 <= row_bytes; x += 8) {
+            uint64_t word;
+            memcpy(&word, row + x, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, row + x, row_bytes - x);
+        mix(tail);
+    }
+    return hash;
+}
+
+image_texture_t::image_texture_t() {
+    live_textures().insert(this);
+}
+
+image_texture_t::~image_texture_t() {
+    live_textures().erase(this);
+    auto &cache = texture_cache();
+    auto it = cache.find(hash);
+    if (it != cache.end() && it->second.expired()) {
+        cache.erase(it);
+    }
+    gl::glDeleteTextures(1, &id);
+    release_tiles();
+}
+
+void image_texture_t::uncache() {
+    auto &cache = texture_cache();
+    auto it = cache.find(hash);
+    if (it != cache.end() && it->second.lock().get() == this) {
+        cache.erase(it);
+    }
+}
+
+// Keeps the content as a CPU copy and drops the GL name, restore_texture() creates a
+// new one. Used before the last context of the share group goes away.
+void image_texture_t::release_name() {
+    if (!id) return;
+    if (pixels.empty()) {
+        pixels.create(size.y(), size.x(), CV_8UC3);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, id);
+        gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 1);
+        gl::glGetTexImage(gl::GL_TEXTURE_2D, 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, pixels.ptr());
+        gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 4);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+    }
+    gl::glDeleteTextures(1, &id);
+    id = 0;
+    pending = true;
+    release_tiles();
+}
+
+void release_image_textures() {
+    for (image_texture_t *texture : live_textures()) {
+        texture->release_name();
+    }
+}
+
+// Uploads what update_image() could not without a context, before the frame's gui() and
+// draw() read texture_id or nuklear_image.
+void upload_image_textures() {
+    for (const Image *image : live_images()) {
+        image->restore_texture(false);
+    }
+}
+
+void image_texture_t::release_tiles() {
+    for (auto &[key, tile] : tile_cache) {
+        gl::glDeleteTextures(1, &tile.id);
+    }
+    tile_cache.clear();
+}
+
+size_t image_texture_t::tile_bytes() const {
+    size_t bytes = 0;
+    for (const auto &[key, tile] : tile_cache) {
+        bytes += size_t(tile.size.x()) * size_t(tile.size.y()) * 3;
+    }
+    return bytes;
+}
+
+void image_texture_t::create() {
+    if (id) return;
+    gl::glGenTextures(1, &id);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, id);
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR_MIPMAP_LINEAR);
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+}
+
+void image_texture_t::upload(const cv::Mat &rgb) {
+    gl::glBindTexture(gl::GL_TEXTURE_2D, id);
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAX_LEVEL, 1000);
+    gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 1);
+    gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGB, size.x(), size.y(), 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, rgb.ptr());
+    gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 4);
+    gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+    frame_counters().upload(size_t(size.x()) * size_t(size.y()) * 3);
+}
+
+void image_texture_t::set_content(const cv::Mat &image) {
+    static uint64_t s_next_version = 0;
+    version = ++s_next_version;
+    image_size = {image.cols, image.rows};
+    type = image.type();
+    // Textures keep the native resolution so zoomed-in widgets show actual pixels,
+    // only images above the cap are scaled down, keeping their aspect ratio.
+    double scale = std::min(1.0, (double)LIGHTVIS_IMAGE_TEXTURE_CAP / std::max(image_size.x(), image_size.y()));
+    size.x() = std::max(1, (int)std::lround(image_size.x() * scale));
+    size.y() = std::max(1, (int)std::lround(image_size.y() * scale));
+
+    release_tiles();
+    pyramid.clear();
+    cv::Mat rgb;
+    if (size == image_size) {
+        cv::cvtColor(image, rgb, cv::COLOR_BGR2RGB);
+    } else {
+        cv::cvtColor(image, rgb, cv::COLOR_BGR2RGB);
+        pyramid.push_back(rgb);
+        while (std::max(pyramid.back().cols, pyramid.back().rows) > 2 * LIGHTVIS_IMAGE_TEXTURE_CAP) {
+            cv::Mat level;
+            cv::pyrDown(pyramid.back(), level);
+            pyramid.push_back(std::move(level));
+        }
+        cv::resize(pyramid.back(), rgb, cv::Size(size.x(), size.y()), 0, 0, cv::INTER_AREA);
+    }
+    pixels = std::move(rgb);
+    pending = true;
+}
+
+Image::Image() {
+    texture_id = 0;
+    nuklear_image = nk_image_id(0);
+    live_images().insert(this);
+}
+
+Image::Image(const Image &other) :
+    nuklear_image(other.nuklear_image), texture_id(other.texture_id), texture_size(other.texture_size), size(other.size), texture(other.texture) {
+    live_images().insert(this);
+}
+
+Image &Image::operator=(const Image &other) {
+    nuklear_image = other.nuklear_image;
+    texture_id = other.texture_id;
+    texture_size = other.texture_size;
+    size = other.size;
+    texture = other.texture;
+    return *this;
+}
+
+Image::~Image() {
+    live_images().erase(this);
 }
 
 void Image::update_image(const cv::Mat &image) {
     size.x() = image.cols;
     size.y() = image.rows;
 
-    if (empty()) return;
+    if (empty()) {
+        texture.reset();
+        texture_id = 0;
+        nuklear_image = nk_image_id(0);
+        return;
+    }
 
-    texture_size.x() = std::min((int)msb((unsigned int)size.x()), 2048);
-    texture_size.y() = std::min((int)msb((unsigned int)size.y()), 2048);
+    if (texture && texture.use_count() == 1) {
+        // Nobody shares the texture, e.g. a streamed image: respecify it in place without
+        // hashing. It leaves the cache as its content is no longer known by hash.
+        texture->uncache();
+        texture->set_content(image);
+    } else {
+        uint64_t hash = content_hash(image);
+        auto &cached = texture_cache()[hash];
+        std::shared_ptr<image_texture_t> shared = cached.lock();
+        if (!shared || shared->image_size != size || shared->type != image.type()) {
+            shared = std::make_shared<image_texture_t>();
+            shared->hash = hash;
+            shared->set_content(image);
+            cached = shared;
+        }
+        texture = std::move(shared);
+    }
 
-    cv::Mat rgb;
-    cv::resize(image, rgb, cv::Size(texture_size.x(), texture_size.y()));
-    cv::cvtColor(rgb, rgb, cv::COLOR_BGR2RGB);
-    gl::glBindTexture(gl::GL_TEXTURE_2D, texture_id);
-    gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGB, texture_size.x(), texture_size.y(), 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, rgb.ptr());
-    gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+    texture_size = texture->size;
+    // Called from gui() or draw() the texture is ready for use right away like before,
+    // without a context it waits for the next frame.
+    if (glfwGetCurrentContext()) {
+        restore_texture();
+    }
+    texture_id = texture->id;
+    nuklear_image = nk_image_id((int)texture_id);
+}
+
+size_t Image::texture_bytes() const {
+    if (!texture || !resident()) return 0;
+    return size_t(texture_size.x()) * size_t(texture_size.y()) * 3 * 4 / 3 + texture->tile_bytes();
+}
+
+bool Image::resident() const {
+    return !texture || texture->pixels.empty();
+}
+
+void Image::evict_texture() const {
+    if (texture && resident()) texture->evict();
+}
+
+const void *Image::texture_key() const {
+    return texture.get();
+}
+
+void Image::texture_drawn(const void *window) const {
+    if (!texture) return;
+    texture->drawn_by = window;
+    texture->drawn_at = glfwGetTime();
+}
+
+std::function<bool()> Image::texture_evictor(const void *window) const {
+    std::weak_ptr<image_texture_t> weak = texture;
+    return [weak, window]() {
+        std::shared_ptr<image_texture_t> shared = weak.lock();
+        // Gone already, nothing left to free.
+        if (!shared) return true;
+        // Held by this evictor and more than one image.
+        if (shared.use_count() > 2) return false;
+        if (shared->drawn_by != window && glfwGetTime() - shared->drawn_at < LIGHTVIS_IMAGE_SHARED_DRAW_SECONDS) return false;
+        if (shared->pixels.empty()) shared->evict();
+        return true;
+    };
+}
+
+void image_texture_t::evict() {
+    pixels.create(size.y(), size.x(), CV_8UC3);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, id);
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 1);
+    gl::glGetTexImage(gl::GL_TEXTURE_2D, 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, pixels.ptr());
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 4);
+    // Respecifying every mip level as empty releases the storage but keeps the name nuklear
+    // and other images sharing the texture refer to. upload() restores the level range.
+    for (int level = 0, extent = std::max(size.x(), size.y()); extent > 0; ++level, extent /= 2) {
+        gl::glTexImage2D(gl::GL_TEXTURE_2D, level, gl::GL_RGB, 0, 0, 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, nullptr);
+    }
+    gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAX_LEVEL, 0);
     gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+    // Tiles are cut from the pyramid again when needed.
+    release_tiles();
+}
+
+void Image::restore_texture(bool evicted) const {
+    if (!texture) return;
+    if (!resident() && (evicted || texture->pending)) {
+        texture->create();
+        texture->upload(texture->pixels);
+        texture->pixels.release();
+        texture->pending = false;
+    }
+    // The name is new when the texture was uploaded through another image sharing it,
+    // or outlived its share group.
+    if (texture_id != texture->id) {
+        texture_id = texture->id;
+        nuklear_image = nk_image_id((int)texture_id);
+    }
+}
+
+uint64_t Image::texture_version() const {
+    return texture ? texture->version : 0;
+}
+
+bool Image::tiled() const {
+    return texture && !texture->pyramid.empty();
+}
+
+void Image::tiles(const Eigen::Vector2f &lo, const Eigen::Vector2f &hi, float screen_width, std::vector<ImageTile> &tiles) const {
+    tiles.clear();
+    if (!tiled() || screen_width <= 0) return;
+    const std::vector<cv::Mat> &pyramid = texture->pyramid;
+    float texels = (hi.x() - lo.x()) / screen_width;
+    int level = (int)std::floor(std::log2(std::max(texels, 1.0f)));
+    if (level >= (int)pyramid.size()) return;
+
+    const cv::Mat &source = pyramid[level];
+    Eigen::Vector2f scale((float)source.cols / size.x(), (float)source.rows / size.y());
+    const int tile_size = LIGHTVIS_IMAGE_TILE_SIZE;
+    int x0 = std::max(0, (int)(lo.x() * scale.x()) / tile_size);
+    int y0 = std::max(0, (int)(lo.y() * scale.y()) / tile_size);
+    int x1 = std::min((source.cols - 1) / tile_size, (int)std::ceil(hi.x() * scale.x() - 1) / tile_size);
+    int y1 = std::min((source.rows - 1) / tile_size, (int)std::ceil(hi.y() * scale.y() - 1) / tile_size);
+
+    uint64_t now = ++texture->tile_clock;
+    for (int ty = y0; ty <= y1; ++ty) {
+        for (int tx = x0; tx <= x1; ++tx) {
+            cv::Rect region(tx * tile_size, ty * tile_size, std::min(tile_size, source.cols - tx * tile_size), std::min(tile_size, source.rows - ty * tile_size));
+            auto [it, inserted] = texture->tile_cache.try_emplace({level, tx, ty});
+            image_texture_t::tile_t &tile = it->second;
+            if (inserted) {
+                cv::Mat pixels = source(region).clone();
+                tile.size = {region.width, region.height};
+                gl::glGenTextures(1, &tile.id);
+                gl::glBindTexture(gl::GL_TEXTURE_2D, tile.id);
+                gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR);
+                gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+                gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+                gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+                gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 1);
+                gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGB, region.width, region.height, 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, pixels.ptr());
+                gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 4);
+                gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+                frame_counters().upload(pixels.total() * 3);
+            }
+            tile.last_used = now;
+            tiles.push_back({tile.id, tile.size, Eigen::Vector2f(region.x / scale.x(), region.y / scale.y()),
+                             Eigen::Vector2f((region.x + region.width) / scale.x(), (region.y + region.height) / scale.y())});
+        }
+    }
+
+    // Keep the cache bounded, dropping tiles not drawn for the longest time first.
+    auto &cache = texture->tile_cache;
+    while (cache.size() > LIGHTVIS_IMAGE_TILE_LIMIT) {
+        auto oldest = std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b) { return a.second.last_used < b.second.last_used; });
+        if (oldest->second.last_used == now) break;
+        gl::glDeleteTextures(1, &oldest->second.id);
+        cache.erase(oldest);
+    }
 }
 
 } // namespace lightvis
@@ -1,8 +1,13 @@
 #include <lightvis/lightvis.h>
+#include <array>
+#include <atomic>
 #include <cstdlib>
+#include <future>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include <Eigen/Eigen>
@@ -18,13 +23,26 @@
 #include <nuklear.h>
 
 #include <lightvis/shader.h>
-#include <lightvis/lightvis_font_roboto.h>
+#include <lightvis/point_cloud.h>
+#include <lightvis/font.h>
+#include <lightvis/gpu_memory.h>
+#include <lightvis/loader.h>
+#include <lightvis/pool.h>
+#include <lightvis/readback.h>
+#include <lightvis/video_encoder.h>
 
 #define LIGHTVIS_DOUBLE_CLICK_MIN_DT 0.02
 #define LIGHTVIS_DOUBLE_CLICK_MAX_DT 0.2
+#define LIGHTVIS_POINT_CLOUD_LOD_PIXELS 2.0
+#define LIGHTVIS_THUMBNAIL_SIZE 256
+#define LIGHTVIS_GUI_BUFFER_INITIAL_SIZE (64 * 1024)
+#define LIGHTVIS_GLFW_HAS_NULL_PLATFORM (GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4))
 
 namespace lightvis {
 
+void release_image_textures();
+void upload_image_textures();
+
 struct vertex_t {
     float position[2];
     float texcoord[2];
@@ -36,13 +54,14 @@ struct context_t {
 
     struct nk_context nuklear;
     struct nk_buffer commands;
-    struct nk_font_atlas font_atlas;
     struct nk_draw_null_texture null_texture;
 
     gl::GLuint program;
     gl::GLuint vshader, fshader;
     gl::GLuint vbo, ebo, vao;
-    gl::GLuint font_texture;
+
+    gl::GLuint offscreen_fbo;
+    gl::GLuint offscreen_color, offscreen_depth;
 
     gl::GLint attribute_position;
     gl::GLint attribute_texcoord;
@@ -68,11 +87,217 @@ struct events_t {
     double last_left_click_time = -std::numeric_limits<double>::max();
 };
 
-struct position_record_t {
-    bool is_trajectory;
-    const std::vector<Eigen::Vector3f> *data;
-    const Eigen::Vector4f *color;
-    const std::vector<Eigen::Vector4f> *colors;
+// The part of a record its Record handles change, owned by the record so it goes away with it.
+// Handles may be used from any thread while the window draws, hence the atomics and the mutex.
+struct record_state_t {
+    std::string layer = "default";
+    std::mutex layer_mutex;
+    std::atomic<bool> visible = true;
+    std::atomic<bool> removed = false;
+};
+
+struct record_base_t {
+    virtual ~record_base_t() = default;
+    virtual void draw(LightVisDetail *detail) = 0;
+    virtual void unload() {
+    }
+
+    std::shared_ptr<record_state_t> state = std::make_shared<record_state_t>();
+};
+
+struct position_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+
+    bool is_trajectory = false;
+    const std::vector<Eigen::Vector3f> *data = nullptr;
+    const Eigen::Vector4f *color = nullptr;
+    const std::vector<Eigen::Vector4f> *colors = nullptr;
+};
+
+// Keeps the positions in its own buffer and uploads only vertices appended since the
+// last frame, the time window then selects the drawn range without touching the buffer.
+struct timed_trajectory_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+    void unload() override {
+        if (memory) memory->release(this);
+        gl::glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        capacity = 0;
+        uploaded = 0;
+    }
+
+    const std::vector<Eigen::Vector3f> *positions = nullptr;
+    const std::vector<double> *timestamps = nullptr;
+    const Eigen::Vector2d *window = nullptr;
+    const Eigen::Vector4f *color = nullptr;
+
+    gl::GLuint buffer = 0;
+    size_t capacity = 0;
+    size_t uploaded = 0;
+    gpu_memory_t *memory = nullptr;
+};
+
+// Image thumbnails live in the layers of one texture array, copied from the image
+// textures on the GPU, so all planes are a single instanced draw.
+struct image_plane_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+    void unload() override {
+        if (memory) memory->release(this);
+        for (array_t &array : arrays) {
+            gl::glDeleteTextures(1, &array.texture);
+        }
+        gl::glDeleteFramebuffers(2, framebuffers);
+        arrays.clear();
+        framebuffers[0] = framebuffers[1] = 0;
+        layers.clear();
+    }
+
+    static constexpr int thumbnail_size = LIGHTVIS_THUMBNAIL_SIZE;
+
+    struct layer_t {
+        uint64_t version = 0;
+    };
+
+    // Image i lives in layer i % layers_per_array of array i / layers_per_array, more than
+    // one array is needed beyond GL_MAX_ARRAY_TEXTURE_LAYERS images.
+    struct array_t {
+        gl::GLuint texture = 0;
+        size_t capacity = 0;
+        bool copied = false;
+    };
+
+    const std::vector<const Image *> *images = nullptr;
+    const std::vector<Eigen::Matrix4f> *poses = nullptr;
+    const Eigen::Vector4f *intrinsics = nullptr;
+    const Eigen::Vector4f *color = nullptr;
+    float depth = 0.5f;
+
+    std::vector<array_t> arrays;
+    gl::GLuint framebuffers[2] = {0, 0};
+    std::vector<layer_t> layers;
+    gpu_memory_t *memory = nullptr;
+};
+
+struct scalar_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+    void unload() override {
+        if (memory) memory->release(this);
+        gl::glDeleteBuffers(2, buffers);
+        buffers[0] = buffers[1] = 0;
+        capacity = 0;
+        uploaded = 0;
+        uploaded_scalars.clear();
+    }
+
+    const std::vector<Eigen::Vector3f> *data = nullptr;
+    const std::vector<float> *scalars = nullptr;
+    const Eigen::Vector2f *range = nullptr;
+    Colormap colormap = Colormap::Turbo;
+
+    // Positions and scalars. Positions are uploaded as appended, like timed trajectories,
+    // scalars are compared with the uploaded copy so only the changed span is sent.
+    gl::GLuint buffers[2] = {0, 0};
+    size_t capacity = 0;
+    size_t uploaded = 0;
+    std::vector<float> uploaded_scalars;
+    gpu_memory_t *memory = nullptr;
+};
+
+struct ellipsoid_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+
+    const std::vector<Eigen::Vector3f> *means = nullptr;
+    const std::vector<Eigen::Matrix3f> *covariances = nullptr;
+    const Eigen::Vector4f *color = nullptr;
+    const std::vector<Eigen::Vector4f> *colors = nullptr;
+    float sigma = 1.0f;
+};
+
+struct label_record_t : public record_base_t {
+    void draw(LightVisDetail *detail) override;
+
+    const std::vector<Eigen::Vector3f> *positions = nullptr;
+    const std::vector<std::string> *labels = nullptr;
+    const Eigen::Vector4f *color = nullptr;
+    float size = LIGHTVIS_FONT_SIZE;
+};
+
+struct voxel_record_t : public record_base_t {
+    voxel_record_t(const VoxelGrid *grid) :
+        grid(grid) {
+    }
+    void draw(LightVisDetail *detail) override;
+    void unload() override {
+        if (memory) memory->release(this);
+        release();
+    }
+    void release() {
+        gl::glDeleteTextures(3, textures);
+        gl::glDeleteBuffers(1, &pool);
+        gl::glDeleteBuffers(1, &origin_buffer);
+        gl::glDeleteBuffers(1, &chunk_buffer);
+        memset(textures, 0, sizeof(textures));
+        pool = origin_buffer = chunk_buffer = 0;
+        pool_slots = 0;
+        slots.clear();
+        free_slots.clear();
+        origins.clear();
+    }
+
+    // Every brick owns a fixed slot of the pool buffer holding its occupied voxels
+    // as (x, y, z, pad, r, g, b, a) bytes, so a changed brick is a single sub-upload.
+    // Entries past the occupied ones are zero and drawn as nothing.
+    static constexpr size_t slot_bytes = VoxelGrid::brick_volume * 8;
+    // Visible bricks are listed as chunks of entries, one instanced draw covers the list.
+    static constexpr int chunk_voxels = 64;
+
+    struct slot_t {
+        size_t index;
+        std::uint64_t version = 0;
+        std::uint32_t count = 0;
+        // Entries that may be non-zero on the GPU, cleared by the next upload.
+        std::uint32_t extent = VoxelGrid::brick_volume;
+    };
+
+    bool allocate_slot(size_t &index);
+
+    const VoxelGrid *grid;
+    // Buffer textures over the pool, the slot origins and the visible chunks.
+    gl::GLuint textures[3] = {0, 0, 0};
+    gl::GLuint pool = 0, origin_buffer = 0, chunk_buffer = 0;
+    size_t pool_slots = 0;
+    std::unordered_map<std::uint64_t, slot_t> slots;
+    std::vector<size_t> free_slots;
+    std::vector<Eigen::Vector4i> origins;
+    bool origins_dirty = false;
+    bool pool_full = false;
+    gpu_memory_t *memory = nullptr;
+};
+
+struct point_cloud_record_t : public record_base_t {
+    point_cloud_record_t(const PointCloud *cloud) :
+        cloud(cloud) {
+    }
+    void draw(LightVisDetail *detail) override;
+    void unload() override {
+        for (auto &chunk : chunks) {
+            if (memory) memory->release(&chunk);
+            gl::glDeleteBuffers(1, &chunk.positions);
+            gl::glDeleteBuffers(1, &chunk.colors);
+        }
+        chunks.clear();
+    }
+
+    struct chunk_buffers_t {
+        gl::GLuint positions = 0;
+        gl::GLuint colors = 0;
+        size_t uploaded = 0;
+    };
+
+    const PointCloud *cloud;
+    const point_cloud_loader_t *loader = nullptr;
+    std::vector<chunk_buffers_t> chunks;
+    gpu_memory_t *memory = nullptr;
 };
 
 std::set<LightVis *> &awaiting_windows() {
@@ -85,6 +310,13 @@ std::map<GLFWwindow *, LightVis *> &active_windows() {
     return s_active;
 }
 
+// Every window's context, offscreen ones included. New contexts share objects with
+// these, so textures and buffers such as cached images are usable from all windows.
+std::set<GLFWwindow *> &shared_contexts() {
+    static std::set<GLFWwindow *> s_shared;
+    return s_shared;
+}
+
 struct panel_t;
 
 struct widget_base_t {
@@ -94,6 +326,8 @@ struct widget_base_t {
     virtual ~widget_base_t() = default;
     int width() const;
     virtual int height() const = 0;
+    Arena &frame_arena() const;
+    gpu_memory_t &gpu_memory() const;
 
     virtual void draw(nk_context *context, const struct nk_rect &rect) = 0;
 
@@ -142,12 +376,22 @@ struct panel_t {
     bool ignored(size_t i) const;
 
     std::vector<std::unique_ptr<widget_base_t>> widgets;
+    Arena *arena = nullptr;
+    gpu_memory_t *memory = nullptr;
 };
 
 int widget_base_t::width() const {
     return panel->width();
 }
 
+Arena &widget_base_t::frame_arena() const {
+    return *panel->arena;
+}
+
+gpu_memory_t &widget_base_t::gpu_memory() const {
+    return *panel->memory;
+}
+
 struct separator_widget_t : public widget_base_t {
     separator_widget_t(panel_t *panel) :
         widget_base_t(panel) {
@@ -168,7 +412,10 @@ bool panel_t::ignored(size_t i) const {
 
 struct label_widget_t : public widget_base_t {
     label_widget_t(panel_t *panel, const std::string &label) :
-        label(label), widget_base_t(panel) {
+        label(&label), widget_base_t(panel) {
+    }
+    label_widget_t(panel_t *panel, std::shared_ptr<Value<std::string>> owned) :
+        label(nullptr), owned(std::move(owned)), widget_base_t(panel) {
     }
     int height() const override {
         return 20;
@@ -177,12 +424,16 @@ struct label_widget_t : public widget_base_t {
     void draw(nk_context *context, const struct nk_rect &rect) override {
         struct nk_rect padded_rect = nk_rect(rect.x + 5, rect.y, rect.w - 10, rect.h);
         nk_layout_space_push(context, padded_rect);
-        nk_label(context, label.c_str(), NK_TEXT_LEFT);
+        nk_label(context, (owned ? owned->get() : *label).c_str(), NK_TEXT_LEFT);
     }
 
-    const std::string &label;
+    const std::string *label;
+    std::shared_ptr<Value<std::string>> owned;
 };
 
+// Scrolling over the image zooms at the cursor, dragging pans and a double click
+// resets the view. Zoomed in, the whole texture is drawn scaled up and clipped to the
+// widget, keeping float precision where a subimage would round to 16-bit texels.
 struct image_widget_t : public widget_base_t {
     image_widget_t(panel_t *panel, const Image *image) :
         image(image), widget_base_t(panel) {
@@ -197,17 +448,80 @@ struct image_widget_t : public widget_base_t {
 
     void draw(nk_context *context, const struct nk_rect &rect) override {
         if (!image->empty()) {
-            nk_layout_space_push(context, rect);
-            nk_image(context, image->nuklear_image);
+            // Images with the same content share a texture and its entry.
+            image->restore_texture();
+            image->texture_drawn(&gpu_memory());
+            gpu_memory().track(image->texture_key(), gpu_memory_t::texture, image->texture_bytes(), 1, image->texture_evictor(&gpu_memory()));
+            interact(context, rect);
+            if (zoom > 1.0f) {
+                nk_command_buffer *canvas = nk_window_get_canvas(context);
+                struct nk_rect clip = canvas->clip;
+                nk_push_scissor(canvas, rect);
+                Eigen::Vector2f rect_size(rect.w, rect.h);
+                Eigen::Vector2f origin = (center - Eigen::Vector2f::Constant(0.5f / zoom)).cwiseProduct(rect_size) * zoom;
+                nk_draw_image(canvas, nk_rect(rect.x - origin.x(), rect.y - origin.y(), rect.w * zoom, rect.h * zoom), &image->nuklear_image, nk_rgb(255, 255, 255));
+                if (image->tiled()) {
+                    draw_tiles(canvas, rect);
+                }
+                nk_push_scissor(canvas, clip);
+            } else {
+                nk_layout_space_push(context, rect);
+                nk_image(context, image->nuklear_image);
+            }
+        }
+    }
+
+    // Covers the overview with full resolution tiles of the visible part, whole tiles are
+    // drawn and the scissor set by draw() cuts them to the widget.
+    void draw_tiles(nk_command_buffer *canvas, const struct nk_rect &rect) {
+        Eigen::Vector2f size = image->size.cast<float>();
+        Eigen::Vector2f lo = (center - Eigen::Vector2f::Constant(0.5f / zoom)).cwiseProduct(size);
+        Eigen::Vector2f hi = (center + Eigen::Vector2f::Constant(0.5f / zoom)).cwiseProduct(size);
+        image->tiles(lo, hi, rect.w, tiles);
+        Eigen::Vector2f pixels = Eigen::Vector2f(rect.w, rect.h).cwiseQuotient(hi - lo);
+        for (const ImageTile &tile : tiles) {
+            Eigen::Vector2f dest_lo = (tile.lo - lo).cwiseProduct(pixels), dest_size = (tile.hi - tile.lo).cwiseProduct(pixels);
+            struct nk_image tile_image = nk_image_id((int)tile.texture_id);
+            nk_draw_image(canvas, nk_rect(rect.x + dest_lo.x(), rect.y + dest_lo.y(), dest_size.x(), dest_size.y()), &tile_image, nk_rgb(255, 255, 255));
         }
     }
 
+    void interact(nk_context *context, const struct nk_rect &rect) {
+        const struct nk_input *input = &context->input;
+        if (nk_input_has_mouse_click_in_rect(input, NK_BUTTON_DOUBLE, rect)) {
+            zoom = 1.0f;
+            center = {0.5f, 0.5f};
+            return;
+        }
+        if (!nk_input_is_mouse_hovering_rect(input, rect)) return;
+        // View coordinates are fractions of the image, the cursor's point stays put while zooming.
+        Eigen::Vector2f cursor((input->mouse.pos.x - rect.x) / rect.w - 0.5f, (input->mouse.pos.y - rect.y) / rect.h - 0.5f);
+        float scroll = input->mouse.scroll_delta.y;
+        if (scroll != 0) {
+            float max_zoom = std::max(1.0f, image->size.maxCoeff() / 8.0f);
+            float new_zoom = std::clamp(zoom * std::pow(1.25f, scroll), 1.0f, max_zoom);
+            center += cursor / zoom - cursor / new_zoom;
+            zoom = new_zoom;
+        }
+        if (nk_input_is_mouse_down(input, NK_BUTTON_LEFT)) {
+            center -= Eigen::Vector2f(input->mouse.delta.x / rect.w, input->mouse.delta.y / rect.h) / zoom;
+        }
+        float half = 0.5f / zoom;
+        center = center.cwiseMax(half).cwiseMin(1.0f - half);
+    }
+
     const Image *image;
+    float zoom = 1.0f;
+    Eigen::Vector2f center = {0.5f, 0.5f};
+    std::vector<ImageTile> tiles;
 };
 
 struct graph_widget_t : public widget_base_t {
     graph_widget_t(panel_t *panel, const std::vector<double> &values) :
-        values(values), widget_base_t(panel) {
+        values(&values), widget_base_t(panel) {
+    }
+    graph_widget_t(panel_t *panel, std::shared_ptr<Value<std::vector<double>>> owned) :
+        values(nullptr), owned(std::move(owned)), widget_base_t(panel) {
     }
 
     int height() const override {
@@ -215,7 +529,9 @@ struct graph_widget_t : public widget_base_t {
     }
 
     void draw(nk_context *context, const struct nk_rect &rect) override {
-        std::vector<float> points;
+        const std::vector<double> &values = owned ? owned->get() : *this->values;
+        ArenaVector<float> points{ArenaAllocator<float>(frame_arena())};
+        points.reserve(values.size() * 2);
         float n = (float)std::max(values.size() - 1, size_t(1));
         for (size_t i = 0; i < values.size(); ++i) {
             points.push_back(rect.x + rect.w * (float)i / n);
@@ -226,12 +542,41 @@ struct graph_widget_t : public widget_base_t {
         nk_stroke_polyline(canvas, points.data(), points.size() / 2, 0.5, nk_rgb(255, 64, 192));
     }
 
-    const std::vector<double> &values;
+    const std::vector<double> *values;
+    std::shared_ptr<Value<std::vector<double>>> owned;
+};
+
+struct histogram_widget_t : public widget_base_t {
+    histogram_widget_t(panel_t *panel, std::shared_ptr<Histogram> histogram) :
+        histogram(std::move(histogram)), widget_base_t(panel) {
+    }
+
+    int height() const override {
+        return 50;
+    }
+
+    void draw(nk_context *context, const struct nk_rect &rect) override {
+        histogram->update();
+        const std::vector<std::uint64_t> &counts = histogram->counts();
+        std::uint64_t peak = *std::max_element(counts.begin(), counts.end());
+        if (peak == 0) return;
+        nk_command_buffer *canvas = nk_window_get_canvas(context);
+        float bar = rect.w / (float)counts.size();
+        for (size_t i = 0; i < counts.size(); ++i) {
+            float h = rect.h * (float)((double)counts[i] / (double)peak);
+            nk_fill_rect(canvas, nk_rect(rect.x + bar * i, rect.y + rect.h - h, std::max(bar - 1.0f, 1.0f), h), 0, nk_rgb(255, 64, 192));
+        }
+    }
+
+    std::shared_ptr<Histogram> histogram;
 };
 
 struct progress_widget_t : public widget_base_t {
     progress_widget_t(panel_t *panel, const double &value) :
-        value(value), widget_base_t(panel) {
+        value(&value), widget_base_t(panel) {
+    }
+    progress_widget_t(panel_t *panel, std::shared_ptr<Value<double>> owned) :
+        value(nullptr), owned(std::move(owned)), widget_base_t(panel) {
     }
 
     int height() const override {
@@ -240,31 +585,118 @@ struct progress_widget_t : public widget_base_t {
 
     void draw(nk_context *context, const struct nk_rect &rect) override {
         nk_command_buffer *canvas = nk_window_get_canvas(context);
-        float v = std::clamp(value, 0.0, 1.0);
+        float v = std::clamp(owned ? owned->get() : *value, 0.0, 1.0);
         nk_fill_rect(canvas, nk_rect(rect.x, rect.y, width() * v, height()), 0, nk_rgb(255, 255, 0));
     }
 
-    const double &value;
+    const double *value;
+    std::shared_ptr<Value<double>> owned;
+};
+
+struct layer_widget_t : public widget_base_t {
+    layer_widget_t(panel_t *panel, std::map<std::string, bool> &layers) :
+        layers(&layers), widget_base_t(panel) {
+    }
+
+    int height() const override {
+        return 20 * (int)layers->size();
+    }
+
+    void draw(nk_context *context, const struct nk_rect &rect) override {
+        struct nk_rect row = nk_rect(rect.x + 5, rect.y, rect.w - 10, 20);
+        for (auto &[name, visible] : *layers) {
+            nk_layout_space_push(context, row);
+            nk_bool active = visible;
+            nk_checkbox_label(context, name.c_str(), &active);
+            visible = active;
+            row.y += row.h;
+        }
+    }
+
+    std::map<std::string, bool> *layers;
 };
 
+// Polynomial fits of the matplotlib viridis and Google turbo colormaps.
+static Eigen::Vector3f colormap_color(Colormap colormap, float t) {
+    switch (colormap) {
+    case Colormap::Gray:
+        return Eigen::Vector3f::Constant(t);
+    case Colormap::Jet:
+        return Eigen::Vector3f(1.5f - std::abs(4.0f * t - 3.0f), 1.5f - std::abs(4.0f * t - 2.0f), 1.5f - std::abs(4.0f * t - 1.0f));
+    case Colormap::Viridis: {
+        static const Eigen::Vector3f c[7] = {
+            {0.2777273272234177f, 0.005407344544966578f, 0.3340998053353061f},
+            {0.1050930431085774f, 1.404613529898575f, 1.384590162594685f},
+            {-0.3308618287255563f, 0.214847559468213f, 0.09509516302823659f},
+            {-4.634230498983486f, -5.799100973351585f, -19.33244095627987f},
+            {6.228269936347081f, 14.17993336680509f, 56.69055260068105f},
+            {4.776384997670288f, -13.74514537774601f, -65.35303263337234f},
+            {-5.435455855934631f, 4.645852612178535f, 26.3124352495832f}};
+        Eigen::Vector3f rgb = c[6];
+        for (int i = 5; i >= 0; --i) {
+            rgb = c[i] + t * rgb;
+        }
+        return rgb;
+    }
+    case Colormap::Turbo:
+    default: {
+        static const Eigen::Vector3f c[6] = {
+            {0.13572138f, 0.09140261f, 0.10667330f},
+            {4.61539260f, 2.19418839f, 12.64194608f},
+            {-42.66032258f, 4.84296658f, -60.58204836f},
+            {132.13108234f, -14.18503333f, 110.36276771f},
+            {-152.94239396f, 4.27729857f, -89.90310912f},
+            {59.28637943f, 2.82956604f, 27.34824973f}};
+        Eigen::Vector3f rgb = c[5];
+        for (int i = 4; i >= 0; --i) {
+            rgb = c[i] + t * rgb;
+        }
+        return rgb;
+    }
+    }
+}
+
 class LightVisDetail {
     LightVis *vis;
 
   public:
     std::string title;
+    bool offscreen = false;
     context_t context;
     viewport_t viewport;
     events_t events;
 
     MouseStates mouse_states;
 
-    std::vector<position_record_t> position_records;
+    std::vector<std::unique_ptr<record_base_t>> records;
+    std::map<std::string, bool> layers;
+    std::vector<std::unique_ptr<loader_base_t>> loaders;
 
     std::unique_ptr<Shader> grid_shader;
     std::unique_ptr<Shader> position_shader;
+    std::map<std::string, std::unique_ptr<Shader>> shaders;
 
     std::map<std::string, std::unique_ptr<panel_t>> panels;
 
+    // Fonts by height in window coordinates, baked at the framebuffer scale.
+    // Textures are per atlas so sizes that resolve to the same atlas share one.
+    std::map<float, struct nk_user_font> fonts;
+    std::map<const font_atlas_t *, gl::GLuint> font_textures;
+    std::map<Colormap, gl::GLuint> colormap_textures;
+    float font_scale = 0;
+
+    std::unique_ptr<video_encoder_t> video_encoder;
+    std::unique_ptr<readback_t> readback;
+
+    // Transient memory of the current frame, released by present().
+    Arena frame_arena;
+    // Backs all nuklear allocations of the window.
+    pool_allocator_t gui_pool;
+    gpu_memory_t gpu_memory;
+
+    Stats stats;
+    bool show_stats = false;
+
     LightVisDetail(LightVis *vis) :
         vis(vis) {
     }
@@ -315,6 +747,8 @@ class LightVisDetail {
     panel_t *get_panel(const std::string &name = "default") {
         if (!panels.count(name)) {
             panels[name] = std::make_unique<panel_t>();
+            panels[name]->arena = &frame_arena;
+            panels[name]->memory = &gpu_memory;
         }
         return panels.at(name).get();
     }
@@ -346,6 +780,13 @@ class LightVisDetail {
             }
         )";
 
+        grid_shader = std::make_unique<Shader>(grid_vshader, grid_fshader);
+    }
+
+    // Windows without records never need this shader, so it is compiled on first use.
+    Shader *get_position_shader() {
+        if (position_shader) return position_shader.get();
+
         static const gl::GLchar *position_vshader = R"(
             #version 150
             uniform mat4 ProjMat;
@@ -375,11 +816,29 @@ class LightVisDetail {
             }
         )";
 
-        grid_shader = std::make_unique<Shader>(grid_vshader, grid_fshader);
         position_shader = std::make_unique<Shader>(position_vshader, position_fshader);
+        return position_shader.get();
+    }
+
+    // Shaders of optional record types, compiled the first time such a record is drawn.
+    Shader *get_shader(const std::string &name, const char *vshader, const char *fshader) {
+        auto &shader = shaders[name];
+        if (!shader) {
+            shader = std::make_unique<Shader>(vshader, fshader);
+        }
+        return shader.get();
     }
 
     void unload() {
+        for (auto &record : records) {
+            record->unload();
+        }
+        for (auto &texture : colormap_textures) {
+            gpu_memory.release(&texture.second);
+            gl::glDeleteTextures(1, &texture.second);
+        }
+        colormap_textures.clear();
+        shaders.clear();
         position_shader.reset();
         grid_shader.reset();
     }
@@ -456,37 +915,137 @@ class LightVisDetail {
         grid_shader->unbind();
     }
 
-    void draw_positions() {
-        gl::glDisable(gl::GL_DEPTH_TEST);
+    Shader *bind_position_shader() {
+        Shader *position_shader = get_position_shader();
         position_shader->bind();
         position_shader->set_uniform("ProjMat", Eigen::Matrix4f(projection_matrix() * view_matrix() * model_matrix()));
         position_shader->set_uniform("Location", viewport.world_xyz);
         position_shader->set_uniform("Scale", viewport.scale);
-        for (const auto &record : position_records) {
-            if (record.data->empty()) continue;
-            static std::vector<Eigen::Vector4f> colors;
-            colors.resize(record.data->size());
-            if (record.color) {
-                std::fill(colors.begin(), colors.end(), *record.color);
-            } else if (record.colors) {
-                std::copy(record.colors->begin(), record.colors->end(), colors.begin());
-            }
-            position_shader->set_attribute("Position", *record.data);
-            position_shader->set_attribute("Color", colors);
-            if (record.is_trajectory) {
-                position_shader->draw(gl::GL_LINE_STRIP, 0, record.data->size());
-            } else {
-                position_shader->draw(gl::GL_POINTS, 0, record.data->size());
+        return position_shader;
+    }
+
+    Record add_record(std::unique_ptr<record_base_t> record) {
+        layers.try_emplace(record->state->layer, true);
+        return Record(records.emplace_back(std::move(record))->state);
+    }
+
+    void draw_records() {
+        // Removed records are released here, where the context is current.
+        for (auto &record : records) {
+            if (record->state->removed) record->unload();
+        }
+        records.erase(std::remove_if(records.begin(), records.end(), [](const auto &record) { return record->state->removed.load(); }), records.end());
+
+        gl::glDisable(gl::GL_DEPTH_TEST);
+        for (auto &record : records) {
+            record_state_t &state = *record->state;
+            if (!state.visible) continue;
+            // Layers set through a handle show up here, handles cannot reach the layer map.
+            std::map<std::string, bool>::iterator layer;
+            {
+                std::lock_guard<std::mutex> lock(state.layer_mutex);
+                layer = layers.try_emplace(state.layer, true).first;
             }
+            if (!layer->second) continue;
+            record->draw(this);
         }
-        position_shader->unbind();
     }
 
     void activate_context() {
         glfwMakeContextCurrent(context.window);
         glbinding::useCurrentContext();
-        glfwGetWindowSize(context.window, &viewport.window_size.x(), &viewport.window_size.y());
-        glfwGetFramebufferSize(context.window, &viewport.framebuffer_size.x(), &viewport.framebuffer_size.y());
+        if (offscreen) {
+            viewport.framebuffer_size = viewport.window_size;
+        } else {
+            glfwGetWindowSize(context.window, &viewport.window_size.x(), &viewport.window_size.y());
+            glfwGetFramebufferSize(context.window, &viewport.framebuffer_size.x(), &viewport.framebuffer_size.y());
+        }
+        update_font_scale();
+    }
+
+    gl::GLuint font_texture(const font_atlas_t *atlas) {
+        gl::GLuint &texture = font_textures[atlas];
+        if (texture) return texture;
+        // The atlas is a coverage mask, so it is stored as R8 and swizzled to (1, 1, 1, coverage).
+        static const gl::GLint font_swizzle[4] = {(gl::GLint)gl::GL_ONE, (gl::GLint)gl::GL_ONE, (gl::GLint)gl::GL_ONE, (gl::GLint)gl::GL_RED};
+        gl::glGenTextures(1, &texture);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+        gl::glTexParameteriv(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_SWIZZLE_RGBA, font_swizzle);
+        gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 1);
+        gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_R8, (gl::GLsizei)atlas->width, (gl::GLsizei)atlas->height, 0, gl::GL_RED, gl::GL_UNSIGNED_BYTE, atlas->alpha);
+        gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, 4);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+        gpu_memory.track(atlas, gpu_memory_t::texture, size_t(atlas->width) * size_t(atlas->height));
+        frame_counters().upload(size_t(atlas->width) * size_t(atlas->height));
+        return texture;
+    }
+
+    // 256 entry lookup table of a colormap, sampled by scalar records.
+    gl::GLuint colormap_texture(Colormap colormap) {
+        gl::GLuint &texture = colormap_textures[colormap];
+        if (texture) return texture;
+        std::array<std::uint8_t, 256 * 4> lut;
+        for (int i = 0; i < 256; ++i) {
+            Eigen::Vector3f rgb = colormap_color(colormap, i / 255.0f).cwiseMax(0.0f).cwiseMin(1.0f);
+            for (int c = 0; c < 3; ++c) {
+                lut[i * 4 + c] = (std::uint8_t)std::lround(rgb[c] * 255.0f);
+            }
+            lut[i * 4 + 3] = 255;
+        }
+        gl::glGenTextures(1, &texture);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+        gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGBA8, 256, 1, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, lut.data());
+        gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+        gpu_memory.track(&texture, gpu_memory_t::texture, lut.size());
+        frame_counters().upload(lut.size());
+        return texture;
+    }
+
+    bool bind_font(float size, struct nk_user_font &font) {
+        const font_atlas_t *atlas = find_font_atlas(size * std::max(font_scale, 1.0f));
+        if (!atlas) return false;
+        gl::GLuint texture = font_texture(atlas);
+        init_user_font(&font, atlas, size, nk_handle_id((int)texture));
+        if (size == LIGHTVIS_FONT_SIZE) {
+            context.null_texture.texture = nk_handle_id((int)texture);
+            context.null_texture.uv = nk_vec2(atlas->null_uv[0], atlas->null_uv[1]);
+        }
+        return true;
+    }
+
+    struct nk_user_font *font(float size) {
+        auto it = fonts.find(size);
+        if (it != fonts.end()) return &it->second;
+        struct nk_user_font &font = fonts[size];
+        if (!bind_font(size, font)) {
+            fprintf(stderr, "Error baking font atlas.\n");
+            fonts.erase(size);
+            return nullptr;
+        }
+        return &font;
+    }
+
+    // Rebinds the fonts to atlases matching the framebuffer scale, e.g. after the
+    // window moved to a HiDPI monitor. Font pointers handed out stay valid.
+    void update_font_scale() {
+        if (viewport.window_size.x() <= 0 || viewport.framebuffer_size.x() <= 0) return;
+        float scale = (float)viewport.framebuffer_size.x() / (float)viewport.window_size.x();
+        if (scale == font_scale) return;
+        font_scale = scale;
+        for (auto &texture : font_textures) {
+            gpu_memory.release(texture.first);
+            gl::glDeleteTextures(1, &texture.second);
+        }
+        font_textures.clear();
+        for (auto &font : fonts) {
+            bind_font(font.first, font.second);
+        }
     }
 
     void process_events() {
@@ -591,8 +1150,15 @@ class LightVisDetail {
         gl::glClear(gl::GL_COLOR_BUFFER_BIT | gl::GL_DEPTH_BUFFER_BIT);
         gl::glPointSize(3);
         draw_grid();
-        draw_positions();
+        draw_records();
         vis->draw(w, h);
+        gpu_memory.track(grid_shader.get(), gpu_memory_t::buffer, grid_shader->buffer_bytes(), grid_shader->buffer_count());
+        if (position_shader) {
+            gpu_memory.track(position_shader.get(), gpu_memory_t::buffer, position_shader->buffer_bytes(), position_shader->buffer_count());
+        }
+        for (auto &[name, shader] : shaders) {
+            gpu_memory.track(shader.get(), gpu_memory_t::buffer, shader->buffer_bytes(), shader->buffer_count());
+        }
     }
     void render_gui() {
         gl::GLfloat ortho[4][4] = {
@@ -642,9 +1208,14 @@ class LightVisDetail {
         config.shape_AA = NK_ANTI_ALIASING_ON;
         config.line_AA = NK_ANTI_ALIASING_ON;
 
+        nk_allocator allocator;
+        allocator.userdata = nk_handle_ptr(&frame_arena);
+        allocator.alloc = frame_arena_alloc;
+        allocator.free = frame_arena_free;
+
         nk_buffer vbuffer, ebuffer;
-        nk_buffer_init_default(&vbuffer);
-        nk_buffer_init_default(&ebuffer);
+        nk_buffer_init(&vbuffer, &allocator, LIGHTVIS_GUI_BUFFER_INITIAL_SIZE);
+        nk_buffer_init(&ebuffer, &allocator, LIGHTVIS_GUI_BUFFER_INITIAL_SIZE);
         nk_convert(&context.nuklear, &context.commands, &vbuffer, &ebuffer, &config);
 
         gl::glBufferData(gl::GL_ARRAY_BUFFER, nk_buffer_total(&vbuffer), nullptr, gl::GL_STREAM_DRAW);
@@ -655,6 +1226,8 @@ class LightVisDetail {
 
         memcpy(vertices, nk_buffer_memory(&vbuffer), nk_buffer_total(&vbuffer));
         memcpy(elements, nk_buffer_memory(&ebuffer), nk_buffer_total(&ebuffer));
+        frame_counters().upload(nk_buffer_total(&vbuffer) + nk_buffer_total(&ebuffer));
+        gpu_memory.track(&context.vbo, gpu_memory_t::buffer, nk_buffer_total(&vbuffer) + nk_buffer_total(&ebuffer), 2);
 
         gl::glUnmapBuffer(gl::GL_ARRAY_BUFFER);
         gl::glUnmapBuffer(gl::GL_ELEMENT_ARRAY_BUFFER);
@@ -674,6 +1247,7 @@ class LightVisDetail {
                 (gl::GLint)(command->clip_rect.w * framebuffer_scale.x()),
                 (gl::GLint)(command->clip_rect.h * framebuffer_scale.y()));
             gl::glDrawElements(gl::GL_TRIANGLES, (gl::GLsizei)command->elem_count, gl::GL_UNSIGNED_SHORT, offset);
+            frame_counters().draw(command->elem_count);
             offset += command->elem_count;
         }
         nk_clear(&context.nuklear);
@@ -687,32 +1261,175 @@ class LightVisDetail {
         gl::glDisable(gl::GL_BLEND);
     }
 
+    void update_loaders() {
+        for (auto &loader : loaders) {
+            loader->update();
+        }
+    }
+
+    void draw_stats() {
+        auto nuklear = &context.nuklear;
+        char lines[10][64];
+        size_t n = 0;
+        snprintf(lines[n++], 64, "Draw calls: %zu", stats.draw_calls);
+        snprintf(lines[n++], 64, "Vertices: %zu", stats.vertices);
+        snprintf(lines[n++], 64, "Uploaded: %.1f KB / frame", stats.uploaded_bytes / 1024.0);
+        snprintf(lines[n++], 64, "Buffers: %zu, %.1f MB", stats.gpu_buffers, stats.gpu_buffer_bytes / 1048576.0);
+        snprintf(lines[n++], 64, "Textures: %zu, %.1f MB", stats.gpu_textures, stats.gpu_texture_bytes / 1048576.0);
+        snprintf(lines[n++], 64, "GPU evictions: %zu", stats.gpu_evictions);
+        snprintf(lines[n++], 64, "GUI memory: %.1f KB", stats.gui_bytes / 1024.0);
+        snprintf(lines[n++], 64, "GUI peak: %.1f KB", stats.gui_peak_bytes / 1024.0);
+        snprintf(lines[n++], 64, "GUI pool: %.1f KB", stats.gui_reserved_bytes / 1024.0);
+        snprintf(lines[n++], 64, "GUI allocations: %zu / frame", stats.gui_allocations);
+
+        struct nk_rect rect = nk_rect(viewport.window_size.x() - 210.0f, 0, 210, 16.0f * n + 10);
+        if (nk_begin(nuklear, "Stats", rect, NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_NO_INPUT)) {
+            nk_layout_row_dynamic(nuklear, 16, 1);
+            for (size_t i = 0; i < n; ++i) {
+                nk_label(nuklear, lines[i], NK_TEXT_LEFT);
+            }
+        }
+        nk_end(nuklear);
+    }
+
+    void render_frame() {
+        update_loaders();
+        upload_image_textures();
+        vis->gui(&context.nuklear, viewport.window_size.x(), viewport.window_size.y());
+        if (show_stats) {
+            draw_stats();
+        }
+        render_canvas();
+        render_gui();
+        gpu_memory.enforce();
+    }
+
     void present() {
-        glfwSwapBuffers(context.window);
+        if (!offscreen) {
+            glfwSwapBuffers(context.window);
+        }
+        frame_arena.reset();
+
+        // Closes the frame's allocation count before it is read below.
+        gui_pool.next_frame();
+        stats.gui_bytes = gui_pool.bytes();
+        stats.gui_peak_bytes = gui_pool.peak_bytes();
+        stats.gui_reserved_bytes = gui_pool.reserved_bytes();
+        stats.gui_allocations = gui_pool.frame_allocations();
+        FrameCounters &counters = frame_counters();
+        stats.draw_calls = counters.draw_calls;
+        stats.vertices = counters.vertices;
+        stats.uploaded_bytes = counters.uploaded_bytes;
+        counters = FrameCounters();
+        stats.gpu_buffers = gpu_memory.objects(gpu_memory_t::buffer);
+        stats.gpu_textures = gpu_memory.objects(gpu_memory_t::texture);
+        stats.gpu_buffer_bytes = gpu_memory.bytes(gpu_memory_t::buffer);
+        stats.gpu_texture_bytes = gpu_memory.bytes(gpu_memory_t::texture);
+        stats.gpu_evictions = gpu_memory.evictions;
     }
 
-    void create_window() {
+    void record_frame() {
+        if (!video_encoder) return;
+        if (!readback) {
+            readback = std::make_unique<readback_t>();
+        }
+        readback->read(viewport.framebuffer_size.x(), viewport.framebuffer_size.y(), [this](cv::Mat &&frame) {
+            video_encoder->push(std::move(frame));
+        });
+        gpu_memory.track(readback.get(), gpu_memory_t::buffer, readback->bytes(), 3);
+    }
+
+    void stop_recording() {
+        if (readback) {
+            readback->finish([this](cv::Mat &&frame) {
+                video_encoder->push(std::move(frame));
+            });
+            gpu_memory.release(readback.get());
+            readback.reset();
+        }
+        video_encoder.reset();
+    }
+
+    void read_framebuffer(cv::Mat &image) {
+        int w = viewport.framebuffer_size.x();
+        int h = viewport.framebuffer_size.y();
+        image.create(h, w, CV_8UC3);
+        gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 1);
+        gl::glReadPixels(0, 0, w, h, gl::GL_BGR, gl::GL_UNSIGNED_BYTE, image.ptr());
+        cv::flip(image, image, 0);
+    }
+
+    bool create_offscreen_framebuffer() {
+        int w = viewport.window_size.x();
+        int h = viewport.window_size.y();
+        gl::glGenRenderbuffers(1, &context.offscreen_color);
+        gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, context.offscreen_color);
+        gl::glRenderbufferStorage(gl::GL_RENDERBUFFER, gl::GL_RGBA8, w, h);
+        gl::glGenRenderbuffers(1, &context.offscreen_depth);
+        gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, context.offscreen_depth);
+        gl::glRenderbufferStorage(gl::GL_RENDERBUFFER, gl::GL_DEPTH_COMPONENT24, w, h);
+        gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, 0);
+        gl::glGenFramebuffers(1, &context.offscreen_fbo);
+        gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, context.offscreen_fbo);
+        gl::glFramebufferRenderbuffer(gl::GL_FRAMEBUFFER, gl::GL_COLOR_ATTACHMENT0, gl::GL_RENDERBUFFER, context.offscreen_color);
+        gl::glFramebufferRenderbuffer(gl::GL_FRAMEBUFFER, gl::GL_DEPTH_ATTACHMENT, gl::GL_RENDERBUFFER, context.offscreen_depth);
+        if (gl::glCheckFramebufferStatus(gl::GL_FRAMEBUFFER) != gl::GL_FRAMEBUFFER_COMPLETE) {
+            return false;
+        }
+        viewport.framebuffer_size = viewport.window_size;
+        gpu_memory.track(&context.offscreen_fbo, gpu_memory_t::texture, size_t(w) * size_t(h) * 8, 2);
+        return true;
+    }
+
+    void create_window(bool hidden = false) {
+        offscreen = hidden;
+
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, (int)gl::GL_TRUE);
 #endif
+        glfwWindowHint(GLFW_VISIBLE, offscreen ? GLFW_FALSE : GLFW_TRUE);
+#if LIGHTVIS_GLFW_HAS_NULL_PLATFORM
+        // The null platform has no native contexts, OSMesa renders on the CPU instead.
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, glfwGetPlatform() == GLFW_PLATFORM_NULL ? GLFW_OSMESA_CONTEXT_API : GLFW_NATIVE_CONTEXT_API);
+#endif
+
+        // Decoding or baking the GUI font is CPU work, overlap it with context creation.
+        // The framebuffer scale is not known yet, so the common 1x and 2x atlases are prepared.
+        auto font_prefetch = std::async(std::launch::async, []() {
+            find_font_atlas(LIGHTVIS_FONT_SIZE);
+            find_font_atlas(LIGHTVIS_FONT_SIZE * 2);
+        });
 
-        if ((context.window = glfwCreateWindow(viewport.window_size.x(), viewport.window_size.y(), title.c_str(), nullptr, nullptr)) == nullptr) return;
+        GLFWwindow *share = shared_contexts().empty() ? nullptr : *shared_contexts().begin();
+        if ((context.window = glfwCreateWindow(viewport.window_size.x(), viewport.window_size.y(), title.c_str(), nullptr, share)) == nullptr) return;
+        shared_contexts().insert(context.window);
 
-        active_windows()[context.window] = vis;
+        if (!offscreen) {
+            active_windows()[context.window] = vis;
+        }
         glfwMakeContextCurrent(context.window);
         glbinding::initialize(glfwGetProcAddress, false);
-        glfwGetFramebufferSize(context.window, &viewport.framebuffer_size.x(), &viewport.framebuffer_size.y());
-        glfwSwapInterval(1);
+        if (offscreen) {
+            if (!create_offscreen_framebuffer()) {
+                fprintf(stderr, "Error creating offscreen framebuffer for %s.\n", title.c_str());
+                release_window();
+                return;
+            }
+        } else {
+            glfwGetFramebufferSize(context.window, &viewport.framebuffer_size.x(), &viewport.framebuffer_size.y());
+            glfwSwapInterval(1);
+        }
 
-        nk_init_default(&context.nuklear, 0);
+        nk_allocator gui_allocator = gui_pool.nuklear();
+        nk_init(&context.nuklear, &gui_allocator, 0);
         context.nuklear.clip.copy = LightVisDetail::clipboard_copy_callback;
         context.nuklear.clip.paste = LightVisDetail::clipboard_paste_callback;
         context.nuklear.clip.userdata = nk_handle_ptr(context.window);
 
-        nk_buffer_init_default(&context.commands);
+        nk_buffer_init(&context.commands, &gui_allocator, LIGHTVIS_GUI_BUFFER_INITIAL_SIZE);
 
         static const gl::GLchar *vshader = R"(
             #version 150
@@ -780,25 +1497,23 @@ class LightVisDetail {
         gl::glBindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, 0);
         gl::glBindVertexArray(0);
 
-        const void *font_image;
-        int font_image_width, font_image_height;
-        nk_font_atlas_init_default(&context.font_atlas);
-        nk_font_atlas_begin(&context.font_atlas);
-        nk_font *roboto = nk_font_atlas_add_from_memory(&context.font_atlas, Roboto_Regular_ttf, Roboto_Regular_ttf_len, 16, nullptr);
-        font_image = nk_font_atlas_bake(&context.font_atlas, &font_image_width, &font_image_height, NK_FONT_ATLAS_RGBA32);
-        gl::glGenTextures(1, &context.font_texture);
-        gl::glBindTexture(gl::GL_TEXTURE_2D, context.font_texture);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR);
-        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
-        gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGBA, (gl::GLsizei)font_image_width, (gl::GLsizei)font_image_height, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, font_image);
-        nk_font_atlas_end(&context.font_atlas, nk_handle_id((int)context.font_texture), &context.null_texture);
-        nk_style_set_font(&context.nuklear, &roboto->handle);
+        update_font_scale();
+        font_prefetch.wait();
+        struct nk_user_font *gui_font = font(LIGHTVIS_FONT_SIZE);
+        if (!gui_font) {
+            fprintf(stderr, "Error creating window %s without a GUI font.\n", title.c_str());
+            release_window();
+            return;
+        }
+        nk_style_set_font(&context.nuklear, gui_font);
 
-        glfwSetMouseButtonCallback(context.window, LightVisDetail::mouse_input_callback);
-        glfwSetScrollCallback(context.window, LightVisDetail::scroll_input_callback);
-        glfwSetCharCallback(context.window, LightVisDetail::character_input_callback);
+        if (!offscreen) {
+            glfwSetMouseButtonCallback(context.window, LightVisDetail::mouse_input_callback);
+            glfwSetScrollCallback(context.window, LightVisDetail::scroll_input_callback);
+            glfwSetCharCallback(context.window, LightVisDetail::character_input_callback);
 
-        glfwSetWindowRefreshCallback(context.window, LightVisDetail::window_refresh_callback);
+            glfwSetWindowRefreshCallback(context.window, LightVisDetail::window_refresh_callback);
+        }
 
         load();
         vis->load();
@@ -807,16 +1522,34 @@ class LightVisDetail {
     void destroy_window() {
         activate_context();
 
+        stop_recording();
+
         vis->unload();
         unload();
+        release_window();
+    }
 
+    // Frees what create_window() set up, also when it failed after creating the context.
+    void release_window() {
         glfwSetWindowRefreshCallback(context.window, nullptr);
         glfwSetCharCallback(context.window, nullptr);
         glfwSetScrollCallback(context.window, nullptr);
         glfwSetMouseButtonCallback(context.window, nullptr);
 
-        gl::glDeleteTextures(1, &context.font_texture);
-        nk_font_atlas_clear(&context.font_atlas);
+        for (auto &texture : font_textures) {
+            gl::glDeleteTextures(1, &texture.second);
+        }
+        font_textures.clear();
+        fonts.clear();
+        font_scale = 0;
+        gpu_memory.clear();
+
+        if (offscreen) {
+            gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, 0);
+            gl::glDeleteFramebuffers(1, &context.offscreen_fbo);
+            gl::glDeleteRenderbuffers(1, &context.offscreen_depth);
+            gl::glDeleteRenderbuffers(1, &context.offscreen_color);
+        }
 
         gl::glDeleteBuffers(1, &context.ebo);
         gl::glDeleteBuffers(1, &context.vbo);
@@ -832,9 +1565,16 @@ class LightVisDetail {
         nk_free(&context.nuklear);
 
         active_windows().erase(context.window);
+        shared_contexts().erase(context.window);
+        if (shared_contexts().empty()) {
+            // The share group ends with this context, content-shared image textures move to
+            // CPU copies so images outliving it are uploaded into the next one.
+            release_image_textures();
+        }
         glfwDestroyWindow(context.window);
 
         memset(&context, 0, sizeof(context_t));
+        offscreen = false;
     }
 
     static void error_callback(int error, const char *description) {
@@ -872,11 +1612,20 @@ class LightVisDetail {
         }
     }
 
+    static void *frame_arena_alloc(nk_handle usr, void *old, nk_size size) {
+        return ((Arena *)usr.ptr)->allocate(size);
+    }
+
+    static void frame_arena_free(nk_handle usr, void *old) {
+    }
+
     static void clipboard_copy_callback(nk_handle usr, const char *text, int len) {
         if (len == 0) return;
-        std::vector<char> str(text, text + len);
-        str.push_back('\0');
-        glfwSetClipboardString((GLFWwindow *)usr.ptr, str.data());
+        auto window = (GLFWwindow *)usr.ptr;
+        char *str = (char *)active_windows().at(window)->detail->frame_arena.allocate(len + 1, 1);
+        memcpy(str, text, len);
+        str[len] = '\0';
+        glfwSetClipboardString(window, str);
     }
 
     static void clipboard_paste_callback(nk_handle usr, struct nk_text_edit *edit) {
@@ -888,13 +1637,55 @@ class LightVisDetail {
     static void window_refresh_callback(GLFWwindow *win) {
         auto vis = active_windows().at(win);
         vis->detail->activate_context();
-        vis->gui(&vis->detail->context.nuklear, vis->detail->viewport.window_size.x(), vis->detail->viewport.window_size.y());
-        vis->detail->render_canvas();
-        vis->detail->render_gui();
+        vis->detail->render_frame();
         vis->detail->present();
     }
 
+    static bool initialize() {
+        static bool s_initialized = false;
+        if (!s_initialized) {
+            glfwSetErrorCallback(error_callback);
+#if LIGHTVIS_GLFW_HAS_NULL_PLATFORM
+            // Offscreen rendering needs no display: without one GLFW runs on its null
+            // platform and contexts come from OSMesa, so capture() works on CPU-only nodes.
+            if (!has_display() && glfwPlatformSupported(GLFW_PLATFORM_NULL)) {
+                glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+            }
+#endif
+            s_initialized = (glfwInit() == GLFW_TRUE);
+        }
+        return s_initialized;
+    }
+
+    static bool has_display() {
+#if defined(_WIN32) || defined(__APPLE__)
+        return true;
+#else
+        return getenv("DISPLAY") || getenv("WAYLAND_DISPLAY");
+#endif
+    }
+
+    bool render_offscreen() {
+        if (!context.window) {
+            if (!initialize()) return false;
+            create_window(true);
+            if (!context.window) return false;
+        }
+        activate_context();
+        render_frame();
+        return true;
+    }
+
+    bool capture(cv::Mat &image) {
+        if (!render_offscreen()) return false;
+        read_framebuffer(image);
+        record_frame();
+        present();
+        return true;
+    }
+
     static int main() {
+        Arena loop_arena(4096);
         glfwInit();
         glfwSetErrorCallback(error_callback);
         while (!active_windows().empty() || !awaiting_windows().empty()) {
@@ -908,7 +1699,7 @@ class LightVisDetail {
             glfwPollEvents();
 
             /* close windows */ {
-                std::vector<LightVis *> closing;
+                ArenaVector<LightVis *> closing{ArenaAllocator<LightVis *>(loop_arena)};
                 for (auto [glfw, vis] : active_windows()) {
                     if (glfwWindowShouldClose(glfw)) {
                         closing.emplace_back(vis);
@@ -923,18 +1714,921 @@ class LightVisDetail {
                 for (auto [glfw, vis] : active_windows()) {
                     vis->detail->activate_context();
                     vis->detail->process_events();
-                    vis->gui(&vis->detail->context.nuklear, vis->detail->viewport.window_size.x(), vis->detail->viewport.window_size.y());
-                    vis->detail->render_canvas();
-                    vis->detail->render_gui();
+                    vis->detail->render_frame();
+                    vis->detail->record_frame();
                     vis->detail->present();
                 }
             }
+
+            loop_arena.reset();
         }
         glfwTerminate();
         return EXIT_SUCCESS;
     }
 };
 
+void position_record_t::draw(LightVisDetail *detail) {
+    if (data->empty()) return;
+    static std::vector<Eigen::Vector4f> vertex_colors;
+    vertex_colors.resize(data->size());
+    if (color) {
+        std::fill(vertex_colors.begin(), vertex_colors.end(), *color);
+    } else if (colors) {
+        std::copy(colors->begin(), colors->end(), vertex_colors.begin());
+    }
+    Shader *shader = detail->bind_position_shader();
+    shader->set_attribute("Position", *data);
+    shader->set_attribute("Color", vertex_colors);
+    if (is_trajectory) {
+        shader->draw(gl::GL_LINE_STRIP, 0, data->size());
+    } else {
+        shader->draw(gl::GL_POINTS, 0, data->size());
+    }
+    shader->unbind();
+}
+
+void scalar_record_t::draw(LightVisDetail *detail) {
+    size_t count = std::min(data->size(), scalars->size());
+    if (count == 0) return;
+
+    // Scalars go to the GPU as they are, the range and colormap are applied per vertex,
+    // so re-ranging only changes a uniform.
+    memory = &detail->gpu_memory;
+    if (count < uploaded) {
+        uploaded = 0;
+        uploaded_scalars.clear();
+    }
+    if (count > capacity) {
+        capacity = std::max<size_t>(1024, capacity * 2);
+        while (capacity < count) capacity *= 2;
+        if (!buffers[0]) gl::glGenBuffers(2, buffers);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers[0]);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(Eigen::Vector3f) * capacity, nullptr, gl::GL_DYNAMIC_DRAW);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers[1]);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(float) * capacity, nullptr, gl::GL_DYNAMIC_DRAW);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        memory->track(this, gpu_memory_t::buffer, (sizeof(Eigen::Vector3f) + sizeof(float)) * capacity, 2);
+        uploaded = 0;
+        uploaded_scalars.clear();
+    }
+    if (count > uploaded) {
+        size_t bytes = sizeof(Eigen::Vector3f) * (count - uploaded);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers[0]);
+        gl::glBufferSubData(gl::GL_ARRAY_BUFFER, sizeof(Eigen::Vector3f) * uploaded, bytes, data->data() + uploaded);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        frame_counters().upload(bytes);
+        uploaded = count;
+    }
+    // Bitwise comparison, so NaN scalars do not count as changed every frame.
+    auto same = [](float a, float b) { return memcmp(&a, &b, sizeof(float)) == 0; };
+    const float *values = scalars->data();
+    size_t kept = std::min(uploaded_scalars.size(), count);
+    size_t lo = std::mismatch(values, values + kept, uploaded_scalars.data(), same).first - values;
+    size_t hi = count;
+    if (count == uploaded_scalars.size()) {
+        while (hi > lo && same(values[hi - 1], uploaded_scalars[hi - 1])) --hi;
+    }
+    if (hi > lo) {
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers[1]);
+        gl::glBufferSubData(gl::GL_ARRAY_BUFFER, sizeof(float) * lo, sizeof(float) * (hi - lo), values + lo);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        frame_counters().upload(sizeof(float) * (hi - lo));
+        uploaded_scalars.assign(values, values + count);
+    }
+    memory->touch(this);
+    static const gl::GLchar *vshader = R"(
+        #version 150
+        uniform mat4 ProjMat;
+        uniform vec3 Location;
+        uniform float Scale;
+        uniform vec2 Range;
+        uniform sampler2D Colormap;
+        in vec3 Position;
+        in float Scalar;
+        out vec3 Frag_Position;
+        out vec4 Frag_Color;
+        void main() {
+            float t = clamp((Scalar - Range.x) / max(Range.y - Range.x, 1e-20), 0.0, 1.0);
+            vec3 p = Scale * (Position - Location);
+            Frag_Position = p;
+            Frag_Color = texture(Colormap, vec2((t * 255.0 + 0.5) / 256.0, 0.5));
+            gl_Position = ProjMat * vec4(p, 1);
+        }
+    )";
+
+    static const gl::GLchar *fshader = R"(
+        #version 150
+        in vec3 Frag_Position;
+        in vec4 Frag_Color;
+        out vec4 Out_Color;
+        void main(){
+            vec3 r = 1.0 - smoothstep(9.5, 10.5, abs(Frag_Position));
+            Out_Color = vec4(Frag_Color.rgb, Frag_Color.a * min(min(r.x, r.y), r.z));
+        }
+    )";
+
+    Shader *shader = detail->get_shader("scalar", vshader, fshader);
+    shader->bind();
+    shader->set_uniform("ProjMat", Eigen::Matrix4f(detail->projection_matrix() * detail->view_matrix() * detail->model_matrix()));
+    shader->set_uniform("Location", detail->viewport.world_xyz);
+    shader->set_uniform("Scale", detail->viewport.scale);
+    shader->set_uniform("Range", *range);
+    shader->set_attribute("Position", buffers[0], 3, gl::GL_FLOAT, gl::GL_FALSE);
+    shader->set_attribute("Scalar", buffers[1], 1, gl::GL_FLOAT, gl::GL_FALSE);
+    gl::glActiveTexture(gl::GL_TEXTURE0);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, detail->colormap_texture(colormap));
+    shader->draw(gl::GL_POINTS, 0, (gl::GLuint)count);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+    shader->unbind();
+}
+
+void timed_trajectory_record_t::draw(LightVisDetail *detail) {
+    size_t count = std::min(positions->size(), timestamps->size());
+    memory = &detail->gpu_memory;
+    if (count < uploaded) uploaded = 0;
+    if (count > capacity) {
+        capacity = std::max<size_t>(1024, capacity * 2);
+        while (capacity < count) capacity *= 2;
+        if (!buffer) gl::glGenBuffers(1, &buffer);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(Eigen::Vector3f) * capacity, nullptr, gl::GL_DYNAMIC_DRAW);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        memory->track(this, gpu_memory_t::buffer, sizeof(Eigen::Vector3f) * capacity);
+        uploaded = 0;
+    }
+    if (count > uploaded) {
+        size_t bytes = sizeof(Eigen::Vector3f) * (count - uploaded);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
+        gl::glBufferSubData(gl::GL_ARRAY_BUFFER, sizeof(Eigen::Vector3f) * uploaded, bytes, positions->data() + uploaded);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        frame_counters().upload(bytes);
+        uploaded = count;
+    }
+
+    // Timestamps are ascending, so the window is a contiguous vertex range.
+    auto first = std::lower_bound(timestamps->begin(), timestamps->begin() + count, window->x());
+    auto last = std::upper_bound(first, timestamps->begin() + count, window->y());
+    if (last - first < 2) return;
+    memory->touch(this);
+
+    Shader *shader = detail->bind_position_shader();
+    shader->set_attribute("Position", buffer, 3, gl::GL_FLOAT, gl::GL_FALSE);
+    shader->set_attribute("Color", *color);
+    shader->draw(gl::GL_LINE_STRIP, (gl::GLuint)(first - timestamps->begin()), (gl::GLuint)(last - first));
+    shader->unbind();
+}
+
+void image_plane_record_t::draw(LightVisDetail *detail) {
+    size_t count = std::min(images->size(), poses->size());
+    if (count == 0) return;
+
+    static const gl::GLchar *vshader = R"(
+        #version 150
+        uniform mat4 ProjMat;
+        uniform vec3 Location;
+        uniform float Scale;
+        in vec2 Corner;
+        in vec3 Origin;
+        in vec3 AxisU;
+        in vec3 AxisV;
+        in float Layer;
+        out vec3 Frag_Position;
+        out vec3 Frag_UV;
+        void main() {
+            vec3 p = Scale * (Origin + Corner.x * AxisU + Corner.y * AxisV - Location);
+            Frag_Position = p;
+            Frag_UV = vec3(Corner, Layer);
+            gl_Position = ProjMat * vec4(p, 1);
+        }
+    )";
+
+    static const gl::GLchar *fshader = R"(
+        #version 150
+        uniform sampler2DArray Textures;
+        in vec3 Frag_Position;
+        in vec3 Frag_UV;
+        out vec4 Out_Color;
+        void main(){
+            vec3 r = 1.0 - smoothstep(9.5, 10.5, abs(Frag_Position));
+            Out_Color = vec4(texture(Textures, Frag_UV).rgb, min(min(r.x, r.y), r.z));
+        }
+    )";
+
+    static const std::vector<Eigen::Vector2f> quad_corners = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+    static const std::vector<unsigned int> quad_indices = {0, 1, 3, 0, 3, 2};
+
+    memory = &detail->gpu_memory;
+    static gl::GLint s_max_layers = 0;
+    if (s_max_layers == 0) {
+        gl::glGetIntegerv(gl::GL_MAX_ARRAY_TEXTURE_LAYERS, &s_max_layers);
+    }
+    const size_t layers_per_array = (size_t)std::max(1, s_max_layers);
+    size_t used_arrays = (count + layers_per_array - 1) / layers_per_array;
+    arrays.resize(std::max(arrays.size(), used_arrays));
+    layers.resize(std::max(layers.size(), count));
+    bool reallocated = false;
+    for (size_t a = 0; a < used_arrays; ++a) {
+        array_t &array = arrays[a];
+        size_t needed = std::min(layers_per_array, count - a * layers_per_array);
+        if (needed <= array.capacity) continue;
+        // Reallocating drops the layers, they are copied again below.
+        array.capacity = std::min(layers_per_array, std::max<size_t>(16, array.capacity * 2));
+        while (array.capacity < needed) array.capacity = std::min(layers_per_array, array.capacity * 2);
+        if (!array.texture) gl::glGenTextures(1, &array.texture);
+        if (!framebuffers[0]) gl::glGenFramebuffers(2, framebuffers);
+        gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, array.texture);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR_MIPMAP_LINEAR);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+        for (int level = 0, size = thumbnail_size; size > 0; ++level, size /= 2) {
+            gl::glTexImage3D(gl::GL_TEXTURE_2D_ARRAY, level, gl::GL_RGB8, size, size, (gl::GLsizei)array.capacity, 0, gl::GL_RGB, gl::GL_UNSIGNED_BYTE, nullptr);
+        }
+        gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, 0);
+        std::fill(layers.begin() + a * layers_per_array, layers.begin() + std::min(layers.size(), (a + 1) * layers_per_array), layer_t());
+        reallocated = true;
+    }
+    if (reallocated) {
+        size_t total = 0;
+        for (const array_t &array : arrays) {
+            total += array.capacity;
+        }
+        memory->track(this, gpu_memory_t::texture, size_t(thumbnail_size) * thumbnail_size * 3 * 4 / 3 * total, arrays.size());
+    }
+
+    // Copy the images whose texture changed into their layer, scaled by the blit. The blit
+    // filters only 2x2 texels, so it reads the mip level nearest above the thumbnail size.
+    bool copied = false;
+    for (size_t i = 0; i < count; ++i) {
+        const Image *image = (*images)[i];
+        if (!image || image->empty()) continue;
+        layer_t &layer = layers[i];
+        if (layer.version == image->texture_version()) continue;
+        image->restore_texture();
+        int level = 0;
+        Eigen::Vector2i source = image->texture_size;
+        while (std::max(source.x(), source.y()) >= 2 * thumbnail_size) {
+            source = (source / 2).cwiseMax(1);
+            level++;
+        }
+        array_t &array = arrays[i / layers_per_array];
+        gl::glBindFramebuffer(gl::GL_READ_FRAMEBUFFER, framebuffers[0]);
+        gl::glFramebufferTexture2D(gl::GL_READ_FRAMEBUFFER, gl::GL_COLOR_ATTACHMENT0, gl::GL_TEXTURE_2D, image->texture_id, level);
+        gl::glBindFramebuffer(gl::GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        gl::glFramebufferTextureLayer(gl::GL_DRAW_FRAMEBUFFER, gl::GL_COLOR_ATTACHMENT0, array.texture, 0, (gl::GLint)(i % layers_per_array));
+        gl::glBlitFramebuffer(0, 0, source.x(), source.y(), 0, 0, thumbnail_size, thumbnail_size, gl::GL_COLOR_BUFFER_BIT, gl::GL_LINEAR);
+        layer.version = image->texture_version();
+        array.copied = true;
+        copied = true;
+    }
+    if (copied) {
+        gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, detail->offscreen ? detail->context.offscreen_fbo : 0);
+        for (array_t &array : arrays) {
+            if (!array.copied) continue;
+            gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, array.texture);
+            gl::glGenerateMipmap(gl::GL_TEXTURE_2D_ARRAY);
+            array.copied = false;
+        }
+        gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, 0);
+    }
+    memory->touch(this);
+
+    // The plane spans the image at depth along the camera's z axis, frustum edges join it to the center.
+    float fx = intrinsics->x(), fy = intrinsics->y(), cx = intrinsics->z(), cy = intrinsics->w();
+    Arena &arena = detail->frame_arena;
+    ArenaVector<Eigen::Vector3f> edges{ArenaAllocator<Eigen::Vector3f>(arena)};
+    ArenaVector<Eigen::Vector4f> edge_colors{ArenaAllocator<Eigen::Vector4f>(arena)};
+    Shader *shader = detail->get_shader("image_plane", vshader, fshader);
+    // One instanced draw per texture array, a single one below the layer limit.
+    for (size_t a = 0; a < arrays.size(); ++a) {
+        ArenaVector<Eigen::Vector3f> origins{ArenaAllocator<Eigen::Vector3f>(arena)};
+        ArenaVector<Eigen::Vector3f> axes_u{ArenaAllocator<Eigen::Vector3f>(arena)};
+        ArenaVector<Eigen::Vector3f> axes_v{ArenaAllocator<Eigen::Vector3f>(arena)};
+        ArenaVector<float> layer_indices{ArenaAllocator<float>(arena)};
+        for (size_t i = a * layers_per_array; i < std::min(count, (a + 1) * layers_per_array); ++i) {
+            const Image *image = (*images)[i];
+            if (!image || image->empty()) continue;
+            const Eigen::Matrix4f &pose = (*poses)[i];
+            Eigen::Vector2f size = image->size.cast<float>();
+            auto corner = [&](float u, float v) {
+                return Eigen::Vector3f(pose.topLeftCorner<3, 3>() * Eigen::Vector3f((u - cx) / fx * depth, (v - cy) / fy * depth, depth) + pose.topRightCorner<3, 1>());
+            };
+            Eigen::Vector3f c00 = corner(0, 0), c10 = corner(size.x(), 0), c01 = corner(0, size.y()), c11 = corner(size.x(), size.y());
+            Eigen::Vector3f center = pose.topRightCorner<3, 1>();
+            origins.push_back(c00);
+            axes_u.push_back(c10 - c00);
+            axes_v.push_back(c01 - c00);
+            layer_indices.push_back((float)(i % layers_per_array));
+            edges.insert(edges.end(), {center, c00, center, c10, center, c01, center, c11, c00, c10, c10, c11, c11, c01, c01, c00});
+        }
+        if (origins.empty()) continue;
+
+        shader->bind();
+        shader->set_uniform("ProjMat", Eigen::Matrix4f(detail->projection_matrix() * detail->view_matrix() * detail->model_matrix()));
+        shader->set_uniform("Location", detail->viewport.world_xyz);
+        shader->set_uniform("Scale", detail->viewport.scale);
+        shader->set_attribute("Corner", quad_corners);
+        shader->set_indices(quad_indices);
+        shader->set_attribute("Origin", origins);
+        shader->set_attribute("AxisU", axes_u);
+        shader->set_attribute("AxisV", axes_v);
+        shader->set_attribute("Layer", layer_indices);
+        shader->set_divisor("Origin", 1);
+        shader->set_divisor("AxisU", 1);
+        shader->set_divisor("AxisV", 1);
+        shader->set_divisor("Layer", 1);
+        gl::glActiveTexture(gl::GL_TEXTURE0);
+        gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, arrays[a].texture);
+        shader->draw_indexed_instanced(gl::GL_TRIANGLES, 0, (gl::GLuint)quad_indices.size(), (gl::GLuint)origins.size());
+        gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, 0);
+        shader->unbind();
+    }
+    if (edges.empty()) return;
+    edge_colors.resize(edges.size(), color ? *color : Eigen::Vector4f(1, 1, 1, 1));
+
+    shader = detail->bind_position_shader();
+    shader->set_attribute("Position", edges);
+    shader->set_attribute("Color", edge_colors);
+    shader->draw(gl::GL_LINES, 0, (gl::GLuint)edges.size());
+    shader->unbind();
+}
+
+static void gen_unit_sphere(std::vector<Eigen::Vector3f> &vertices, std::vector<unsigned int> &indices) {
+    const int slices = 16, stacks = 8;
+    for (int i = 0; i <= stacks; ++i) {
+        float theta = (float)M_PI * i / stacks;
+        for (int j = 0; j < slices; ++j) {
+            float phi = 2.0f * (float)M_PI * j / slices;
+            vertices.emplace_back(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            unsigned int a = i * slices + j, b = i * slices + (j + 1) % slices;
+            unsigned int c = a + slices, d = b + slices;
+            indices.insert(indices.end(), {a, c, b, b, c, d});
+        }
+    }
+}
+
+void ellipsoid_record_t::draw(LightVisDetail *detail) {
+    size_t count = std::min(means->size(), covariances->size());
+    if (count == 0) return;
+
+    // The ellipsoid is the unit sphere mapped by the Cholesky factor of the covariance,
+    // factored per vertex on the GPU so the CPU only repacks the symmetric matrices.
+    static const gl::GLchar *vshader = R"(
+        #version 150
+        uniform mat4 ProjMat;
+        uniform vec3 Location;
+        uniform float Scale;
+        uniform float Sigma;
+        in vec3 Vertex;
+        in vec3 Mean;
+        in vec3 CovDiag;
+        in vec3 CovOff;
+        in vec4 Color;
+        out vec3 Frag_Position;
+        out vec4 Frag_Color;
+        void main() {
+            float l00 = sqrt(max(CovDiag.x, 0.0));
+            float l10 = CovOff.x / max(l00, 1e-12);
+            float l20 = CovOff.y / max(l00, 1e-12);
+            float l11 = sqrt(max(CovDiag.y - l10 * l10, 0.0));
+            float l21 = (CovOff.z - l20 * l10) / max(l11, 1e-12);
+            float l22 = sqrt(max(CovDiag.z - l20 * l20 - l21 * l21, 0.0));
+            mat3 L = mat3(l00, l10, l20, 0.0, l11, l21, 0.0, 0.0, l22);
+            // Normals map by the cofactor matrix, which stays defined for flat ellipsoids.
+            mat3 C = mat3(cross(L[1], L[2]), cross(L[2], L[0]), cross(L[0], L[1]));
+            vec3 n = normalize(C * Vertex + vec3(1e-12));
+            float shade = 0.55 + 0.45 * abs(dot(n, normalize(vec3(0.3, 0.5, 0.8))));
+            vec3 p = Scale * (Mean + Sigma * (L * Vertex) - Location);
+            Frag_Position = p;
+            Frag_Color = vec4(Color.rgb * shade, Color.a);
+            gl_Position = ProjMat * vec4(p, 1);
+        }
+    )";
+
+    static const gl::GLchar *fshader = R"(
+        #version 150
+        in vec3 Frag_Position;
+        in vec4 Frag_Color;
+        out vec4 Out_Color;
+        void main(){
+            vec3 r = 1.0 - smoothstep(9.5, 10.5, abs(Frag_Position));
+            Out_Color = vec4(Frag_Color.rgb, Frag_Color.a * min(min(r.x, r.y), r.z));
+        }
+    )";
+
+    static std::vector<Eigen::Vector3f> sphere_vertices;
+    static std::vector<unsigned int> sphere_indices;
+    if (sphere_vertices.empty()) {
+        gen_unit_sphere(sphere_vertices, sphere_indices);
+    }
+
+    Arena &arena = detail->frame_arena;
+    ArenaVector<Eigen::Vector3f> cov_diag{ArenaAllocator<Eigen::Vector3f>(arena)};
+    ArenaVector<Eigen::Vector3f> cov_off{ArenaAllocator<Eigen::Vector3f>(arena)};
+    ArenaVector<Eigen::Vector4f> instance_colors{ArenaAllocator<Eigen::Vector4f>(arena)};
+    cov_diag.resize(count);
+    cov_off.resize(count);
+    instance_colors.resize(count, color ? *color : Eigen::Vector4f(1, 1, 1, 1));
+    for (size_t i = 0; i < count; ++i) {
+        const Eigen::Matrix3f &cov = (*covariances)[i];
+        cov_diag[i] = cov.diagonal();
+        cov_off[i] = {cov(0, 1), cov(0, 2), cov(1, 2)};
+    }
+    if (colors) {
+        std::copy_n(colors->begin(), std::min(count, colors->size()), instance_colors.begin());
+    }
+
+    Shader *shader = detail->get_shader("ellipsoid", vshader, fshader);
+    shader->bind();
+    shader->set_uniform("ProjMat", Eigen::Matrix4f(detail->projection_matrix() * detail->view_matrix() * detail->model_matrix()));
+    shader->set_uniform("Location", detail->viewport.world_xyz);
+    shader->set_uniform("Scale", detail->viewport.scale);
+    shader->set_uniform("Sigma", sigma);
+    shader->set_attribute("Vertex", sphere_vertices);
+    shader->set_indices(sphere_indices);
+    shader->set_attribute("Mean", *means);
+    shader->set_attribute("CovDiag", cov_diag);
+    shader->set_attribute("CovOff", cov_off);
+    shader->set_attribute("Color", instance_colors);
+    shader->set_divisor("Mean", 1);
+    shader->set_divisor("CovDiag", 1);
+    shader->set_divisor("CovOff", 1);
+    shader->set_divisor("Color", 1);
+    gl::glEnable(gl::GL_DEPTH_TEST);
+    shader->draw_indexed_instanced(gl::GL_TRIANGLES, 0, (gl::GLuint)sphere_indices.size(), (gl::GLuint)count);
+    gl::glDisable(gl::GL_DEPTH_TEST);
+    shader->unbind();
+}
+
+void label_record_t::draw(LightVisDetail *detail) {
+    size_t count = std::min(positions->size(), labels->size());
+    if (count == 0) return;
+
+    // Every glyph is one instance of a unit quad, offset in pixels from its projected anchor.
+    static const gl::GLchar *vshader = R"(
+        #version 150
+        uniform mat4 ProjMat;
+        uniform vec3 Location;
+        uniform float Scale;
+        uniform vec2 Viewport;
+        in vec2 Corner;
+        in vec3 Anchor;
+        in vec4 Rect;
+        in vec4 UV;
+        out vec2 Frag_UV;
+        void main() {
+            vec4 p = ProjMat * vec4(Scale * (Anchor - Location), 1);
+            vec2 offset = mix(Rect.xy, Rect.zw, Corner);
+            p.xy += vec2(offset.x, -offset.y) * 2.0 / Viewport * p.w;
+            Frag_UV = mix(UV.xy, UV.zw, Corner);
+            gl_Position = p;
+        }
+    )";
+
+    static const gl::GLchar *fshader = R"(
+        #version 150
+        uniform sampler2D Texture;
+        uniform vec4 Color;
+        in vec2 Frag_UV;
+        out vec4 Out_Color;
+        void main(){
+            Out_Color = Color * texture(Texture, Frag_UV);
+        }
+    )";
+
+    static const std::vector<Eigen::Vector2f> quad_corners = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+    static const std::vector<unsigned int> quad_indices = {0, 1, 3, 0, 3, 2};
+
+    const viewport_t &viewport = detail->viewport;
+    Eigen::Vector2f framebuffer = viewport.framebuffer_size.cast<float>();
+    if (framebuffer.x() <= 0 || framebuffer.y() <= 0) return;
+    float pixel_size = size * std::max(detail->font_scale, 1.0f);
+    const font_atlas_t *atlas = find_font_atlas(pixel_size);
+    if (!atlas) return;
+    float glyph_scale = pixel_size / atlas->size;
+    auto find_glyph = [atlas](nk_rune codepoint) {
+        const font_glyph_t *glyph = atlas->find_glyph(codepoint);
+        return glyph ? glyph : atlas->find_glyph('?');
+    };
+
+    // Project the anchors and keep the ones in front of the camera and inside the fade box.
+    struct placed_t {
+        size_t index;
+        float depth;
+        Eigen::Vector2f anchor;
+    };
+    Arena &arena = detail->frame_arena;
+    ArenaVector<placed_t> placed{ArenaAllocator<placed_t>(arena)};
+    Eigen::Matrix4f mvp = detail->projection_matrix() * detail->view_matrix() * detail->model_matrix();
+    for (size_t i = 0; i < count; ++i) {
+        Eigen::Vector3f p = viewport.scale * ((*positions)[i] - viewport.world_xyz);
+        if ((p.array().abs() > 10.0f).any()) continue;
+        Eigen::Vector4f clip = mvp * p.homogeneous();
+        if (clip.w() <= 0) continue;
+        Eigen::Vector3f ndc = clip.head<3>() / clip.w();
+        if ((ndc.array().abs() > 1.0f).any()) continue;
+        placed.push_back({i, ndc.z(), {(ndc.x() * 0.5f + 0.5f) * framebuffer.x(), (0.5f - ndc.y() * 0.5f) * framebuffer.y()}});
+    }
+    if (placed.empty()) return;
+
+    // Declutter nearest first: a label is dropped when its box overlaps one already placed,
+    // tested on a coarse occupancy grid over the framebuffer.
+    std::sort(placed.begin(), placed.end(), [](const placed_t &a, const placed_t &b) { return a.depth < b.depth; });
+    constexpr int cell = 4;
+    int columns = (int)framebuffer.x() / cell + 1, rows = (int)framebuffer.y() / cell + 1;
+    ArenaVector<std::uint8_t> occupied{ArenaAllocator<std::uint8_t>(arena)};
+    occupied.resize(size_t(columns) * size_t(rows), 0);
+
+    const float margin = 2.0f * glyph_scale;
+    ArenaVector<Eigen::Vector3f> anchors{ArenaAllocator<Eigen::Vector3f>(arena)};
+    ArenaVector<Eigen::Vector4f> rects{ArenaAllocator<Eigen::Vector4f>(arena)};
+    ArenaVector<Eigen::Vector4f> uvs{ArenaAllocator<Eigen::Vector4f>(arena)};
+    for (const placed_t &label : placed) {
+        const std::string &text = (*labels)[label.index];
+        float width = 0;
+        for (int offset = 0, len = (int)text.size(); offset < len;) {
+            nk_rune codepoint;
+            int glyph_len = nk_utf_decode(text.data() + offset, &codepoint, len - offset);
+            if (glyph_len == 0 || codepoint == NK_UTF_INVALID) break;
+            width += find_glyph(codepoint)->xadvance * glyph_scale;
+            offset += glyph_len;
+        }
+        if (width == 0) continue;
+
+        // The text sits above and right of its anchor.
+        Eigen::Vector2f lo = label.anchor + Eigen::Vector2f(margin, -margin - pixel_size);
+        Eigen::Vector2f hi = lo + Eigen::Vector2f(width, pixel_size);
+        int x0 = std::max(0, (int)lo.x() / cell), x1 = std::min(columns - 1, (int)hi.x() / cell);
+        int y0 = std::max(0, (int)lo.y() / cell), y1 = std::min(rows - 1, (int)hi.y() / cell);
+        bool overlaps = false;
+        for (int y = y0; y <= y1 && !overlaps; ++y) {
+            for (int x = x0; x <= x1 && !overlaps; ++x) {
+                overlaps = occupied[size_t(y) * columns + x];
+            }
+        }
+        if (overlaps) continue;
+        for (int y = y0; y <= y1; ++y) {
+            std::fill_n(occupied.begin() + size_t(y) * columns + x0, std::max(0, x1 - x0 + 1), 1);
+        }
+
+        const Eigen::Vector3f &anchor = (*positions)[label.index];
+        float pen = margin;
+        for (int offset = 0, len = (int)text.size(); offset < len;) {
+            nk_rune codepoint;
+            int glyph_len = nk_utf_decode(text.data() + offset, &codepoint, len - offset);
+            if (glyph_len == 0 || codepoint == NK_UTF_INVALID) break;
+            const font_glyph_t *glyph = find_glyph(codepoint);
+            if (glyph->x1 > glyph->x0 && glyph->y1 > glyph->y0) {
+                anchors.push_back(anchor);
+                rects.emplace_back(pen + glyph->x0 * glyph_scale, lo.y() - label.anchor.y() + glyph->y0 * glyph_scale,
+                                   pen + glyph->x1 * glyph_scale, lo.y() - label.anchor.y() + glyph->y1 * glyph_scale);
+                uvs.emplace_back(glyph->u0, glyph->v0, glyph->u1, glyph->v1);
+            }
+            pen += glyph->xadvance * glyph_scale;
+            offset += glyph_len;
+        }
+    }
+    if (anchors.empty()) return;
+
+    Shader *shader = detail->get_shader("label", vshader, fshader);
+    shader->bind();
+    shader->set_uniform("ProjMat", mvp);
+    shader->set_uniform("Location", viewport.world_xyz);
+    shader->set_uniform("Scale", viewport.scale);
+    shader->set_uniform("Viewport", framebuffer);
+    shader->set_uniform("Color", color ? *color : Eigen::Vector4f(1, 1, 1, 1));
+    shader->set_attribute("Corner", quad_corners);
+    shader->set_indices(quad_indices);
+    shader->set_attribute("Anchor", anchors);
+    shader->set_attribute("Rect", rects);
+    shader->set_attribute("UV", uvs);
+    shader->set_divisor("Anchor", 1);
+    shader->set_divisor("Rect", 1);
+    shader->set_divisor("UV", 1);
+    gl::glActiveTexture(gl::GL_TEXTURE0);
+    gl::glBindTexture(gl::GL_TEXTURE_2D, detail->font_texture(atlas));
+    shader->draw_indexed_instanced(gl::GL_TRIANGLES, 0, (gl::GLuint)quad_indices.size(), (gl::GLuint)anchors.size());
+    gl::glBindTexture(gl::GL_TEXTURE_2D, 0);
+    shader->unbind();
+}
+
+// A box is culled when all its corners are outside one of the clip planes.
+static bool is_box_visible(const Eigen::Matrix4f &mvp, const Eigen::Vector3f &lo, const Eigen::Vector3f &hi) {
+    Eigen::Matrix<float, 4, 8> corners;
+    for (int i = 0; i < 8; ++i) {
+        corners.col(i) = mvp * Eigen::Vector4f((i & 1) ? hi.x() : lo.x(), (i & 2) ? hi.y() : lo.y(), (i & 4) ? hi.z() : lo.z(), 1.0f);
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if ((corners.row(axis).array() < -corners.row(3).array()).all()) return false;
+        if ((corners.row(axis).array() > corners.row(3).array()).all()) return false;
+    }
+    return true;
+}
+
+bool voxel_record_t::allocate_slot(size_t &index) {
+    if (free_slots.empty()) {
+        // Grow the pool by doubling, carrying the uploaded bricks over on the GPU. The pool
+        // is read as a buffer texture, which bounds its size.
+        static gl::GLint s_max_texels = 0;
+        if (s_max_texels == 0) {
+            gl::glGetIntegerv(gl::GL_MAX_TEXTURE_BUFFER_SIZE, &s_max_texels);
+        }
+        size_t max_slots = size_t(s_max_texels) / VoxelGrid::brick_volume;
+        size_t new_slots = std::min(std::max<size_t>(64, pool_slots * 2), max_slots);
+        if (new_slots <= pool_slots) {
+            if (!pool_full) {
+                fprintf(stderr, "Error drawing voxels: more than %zu bricks do not fit a buffer texture.\n", max_slots);
+                pool_full = true;
+            }
+            return false;
+        }
+        gl::GLuint new_pool;
+        gl::glGenBuffers(1, &new_pool);
+        gl::glBindBuffer(gl::GL_COPY_WRITE_BUFFER, new_pool);
+        gl::glBufferData(gl::GL_COPY_WRITE_BUFFER, slot_bytes * new_slots, nullptr, gl::GL_DYNAMIC_DRAW);
+        if (pool) {
+            gl::glBindBuffer(gl::GL_COPY_READ_BUFFER, pool);
+            gl::glCopyBufferSubData(gl::GL_COPY_READ_BUFFER, gl::GL_COPY_WRITE_BUFFER, 0, 0, slot_bytes * pool_slots);
+            gl::glBindBuffer(gl::GL_COPY_READ_BUFFER, 0);
+            gl::glDeleteBuffers(1, &pool);
+        } else {
+            gl::glGenTextures(3, textures);
+            gl::glGenBuffers(1, &origin_buffer);
+            gl::glGenBuffers(1, &chunk_buffer);
+        }
+        gl::glBindBuffer(gl::GL_COPY_WRITE_BUFFER, 0);
+        for (size_t i = new_slots; i > pool_slots; --i) {
+            free_slots.push_back(i - 1);
+        }
+        pool = new_pool;
+        pool_slots = new_slots;
+        origins.resize(pool_slots, Eigen::Vector4i::Zero());
+        gl::glBindTexture(gl::GL_TEXTURE_BUFFER, textures[0]);
+        gl::glTexBuffer(gl::GL_TEXTURE_BUFFER, gl::GL_RG32UI, pool);
+        gl::glBindTexture(gl::GL_TEXTURE_BUFFER, 0);
+        // Evicted bricks are uploaded from the grid again on the next draw.
+        memory->track(this, gpu_memory_t::buffer, (slot_bytes + sizeof(Eigen::Vector4i)) * pool_slots, 3, [this]() {
+            release();
+            return true;
+        });
+    }
+    index = free_slots.back();
+    free_slots.pop_back();
+    return true;
+}
+
+void voxel_record_t::draw(LightVisDetail *detail) {
+    // Instances are entries of the visible chunks: the chunk list gives the pool entry of
+    // a chunk's first voxel, its slot the brick origin.
+    static const gl::GLchar *vshader = R"(
+        #version 150
+        uniform mat4 ProjMat;
+        uniform vec3 Location;
+        uniform float Scale;
+        uniform float VoxelSize;
+        uniform usamplerBuffer Pool;
+        uniform isamplerBuffer Origins;
+        uniform usamplerBuffer Chunks;
+        in vec3 Vertex;
+        in vec3 Normal;
+        out vec3 Frag_Position;
+        out vec4 Frag_Color;
+        void main() {
+            int entry = int(texelFetch(Chunks, gl_InstanceID / 64).r) + gl_InstanceID % 64;
+            uvec2 voxel = texelFetch(Pool, entry).rg;
+            if (voxel.y == 0u) {
+                Frag_Position = vec3(0);
+                Frag_Color = vec4(0);
+                gl_Position = vec4(2, 2, 2, 1);
+                return;
+            }
+            vec3 origin = vec3(texelFetch(Origins, entry / 512).xyz);
+            vec3 cell = vec3(uvec3(voxel.x, voxel.x >> 8, voxel.x >> 16) & 255u);
+            vec4 color = vec4(uvec4(voxel.y, voxel.y >> 8, voxel.y >> 16, voxel.y >> 24) & 255u) / 255.0;
+            float shade = 0.6 + 0.4 * abs(dot(Normal, normalize(vec3(0.3, 0.5, 0.8))));
+            vec3 p = Scale * (VoxelSize * (origin + cell + Vertex) - Location);
+            Frag_Position = p;
+            Frag_Color = vec4(color.rgb * shade, color.a);
+            gl_Position = ProjMat * vec4(p, 1);
+        }
+    )";
+
+    static const gl::GLchar *fshader = R"(
+        #version 150
+        in vec3 Frag_Position;
+        in vec4 Frag_Color;
+        out vec4 Out_Color;
+        void main(){
+            vec3 r = 1.0 - smoothstep(9.5, 10.5, abs(Frag_Position));
+            Out_Color = vec4(Frag_Color.rgb, Frag_Color.a * min(min(r.x, r.y), r.z));
+        }
+    )";
+
+    static std::vector<Eigen::Vector3f> cube_vertices, cube_normals;
+    static std::vector<unsigned int> cube_indices;
+    if (cube_vertices.empty()) {
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int side = 0; side < 2; ++side) {
+                Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+                normal[axis] = side ? 1.0f : -1.0f;
+                unsigned int base = (unsigned int)cube_vertices.size();
+                for (int corner = 0; corner < 4; ++corner) {
+                    Eigen::Vector3f v;
+                    v[axis] = (float)side;
+                    v[(axis + 1) % 3] = (float)(corner & 1);
+                    v[(axis + 2) % 3] = (float)(corner >> 1);
+                    cube_vertices.push_back(v);
+                    cube_normals.push_back(normal);
+                }
+                cube_indices.insert(cube_indices.end(), {base, base + 1, base + 3, base, base + 3, base + 2});
+            }
+        }
+    }
+
+    memory = &detail->gpu_memory;
+    const auto &bricks = grid->bricks();
+
+    // Bring the pool in sync: drop removed bricks, then upload the new and changed ones.
+    for (auto it = slots.begin(); it != slots.end();) {
+        if (bricks.count(it->first) == 0) {
+            free_slots.push_back(it->second.index);
+            it = slots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    Arena &arena = detail->frame_arena;
+    auto *packed = (std::uint8_t *)arena.allocate(slot_bytes);
+    for (const auto &[key, brick] : bricks) {
+        auto it = slots.find(key);
+        if (it == slots.end()) {
+            size_t index;
+            if (!allocate_slot(index)) continue;
+            it = slots.emplace(key, slot_t{index}).first;
+            origins[index] = Eigen::Vector4i(brick.origin.x(), brick.origin.y(), brick.origin.z(), 0);
+            origins_dirty = true;
+        }
+        slot_t &slot = it->second;
+        if (slot.version == brick.version) continue;
+        std::uint32_t count = 0;
+        for (int i = 0; i < VoxelGrid::brick_volume; ++i) {
+            if (brick.voxels[i] == 0) continue;
+            std::uint8_t *voxel = packed + 8 * count++;
+            voxel[0] = (std::uint8_t)(i & 7);
+            voxel[1] = (std::uint8_t)((i >> 3) & 7);
+            voxel[2] = (std::uint8_t)(i >> 6);
+            voxel[3] = 0;
+            memcpy(voxel + 4, &brick.voxels[i], 4);
+        }
+        // Entries left over from earlier content of the slot are cleared in the same upload.
+        std::uint32_t extent = std::max(count, slot.extent);
+        memset(packed + 8 * count, 0, 8 * (extent - count));
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, pool);
+        gl::glBufferSubData(gl::GL_ARRAY_BUFFER, slot_bytes * slot.index, 8 * extent, packed);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        frame_counters().upload(8 * extent);
+        slot.version = brick.version;
+        slot.count = count;
+        slot.extent = count;
+    }
+    if (slots.empty()) return;
+    memory->touch(this);
+
+    if (origins_dirty) {
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, origin_buffer);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(Eigen::Vector4i) * origins.size(), origins.data(), gl::GL_DYNAMIC_DRAW);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        gl::glBindTexture(gl::GL_TEXTURE_BUFFER, textures[1]);
+        gl::glTexBuffer(gl::GL_TEXTURE_BUFFER, gl::GL_RGBA32I, origin_buffer);
+        frame_counters().upload(sizeof(Eigen::Vector4i) * origins.size());
+        origins_dirty = false;
+    }
+
+    const viewport_t &viewport = detail->viewport;
+    Eigen::Matrix4f mvp = detail->projection_matrix() * detail->view_matrix() * detail->model_matrix();
+    float voxel_size = grid->voxel_size();
+
+    // Cull per brick, listing the chunks holding occupied entries of the visible ones.
+    ArenaVector<std::uint32_t> chunks{ArenaAllocator<std::uint32_t>(arena)};
+    for (const auto &[key, slot] : slots) {
+        if (slot.count == 0) continue;
+        const VoxelGrid::Brick &brick = bricks.at(key);
+        Eigen::Vector3f lo = viewport.scale * (voxel_size * brick.origin.cast<float>() - viewport.world_xyz);
+        Eigen::Vector3f hi = lo + Eigen::Vector3f::Constant(viewport.scale * voxel_size * VoxelGrid::brick_size);
+        if ((lo.array() > 10.5f).any() || (hi.array() < -10.5f).any()) continue;
+        if (!is_box_visible(mvp, lo, hi)) continue;
+        for (std::uint32_t first = 0; first < slot.count; first += chunk_voxels) {
+            chunks.push_back(std::uint32_t(slot.index * VoxelGrid::brick_volume + first));
+        }
+    }
+    if (chunks.empty()) return;
+    gl::glBindBuffer(gl::GL_ARRAY_BUFFER, chunk_buffer);
+    gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(std::uint32_t) * chunks.size(), chunks.data(), gl::GL_STREAM_DRAW);
+    gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+    gl::glBindTexture(gl::GL_TEXTURE_BUFFER, textures[2]);
+    gl::glTexBuffer(gl::GL_TEXTURE_BUFFER, gl::GL_R32UI, chunk_buffer);
+    frame_counters().upload(sizeof(std::uint32_t) * chunks.size());
+
+    Shader *shader = detail->get_shader("voxel", vshader, fshader);
+    shader->bind();
+    shader->set_uniform("ProjMat", mvp);
+    shader->set_uniform("Location", viewport.world_xyz);
+    shader->set_uniform("Scale", viewport.scale);
+    shader->set_uniform("VoxelSize", voxel_size);
+    shader->set_sampler("Pool", 0);
+    shader->set_sampler("Origins", 1);
+    shader->set_sampler("Chunks", 2);
+    shader->set_attribute("Vertex", cube_vertices);
+    shader->set_attribute("Normal", cube_normals);
+    shader->set_indices(cube_indices);
+    static const gl::GLenum units[3] = {gl::GL_TEXTURE0, gl::GL_TEXTURE1, gl::GL_TEXTURE2};
+    for (int unit = 0; unit < 3; ++unit) {
+        gl::glActiveTexture(units[unit]);
+        gl::glBindTexture(gl::GL_TEXTURE_BUFFER, textures[unit]);
+    }
+    gl::glEnable(gl::GL_DEPTH_TEST);
+    shader->draw_indexed_instanced(gl::GL_TRIANGLES, 0, (gl::GLuint)cube_indices.size(), (gl::GLuint)(chunks.size() * chunk_voxels));
+    gl::glDisable(gl::GL_DEPTH_TEST);
+    for (int unit = 2; unit >= 0; --unit) {
+        gl::glActiveTexture(units[unit]);
+        gl::glBindTexture(gl::GL_TEXTURE_BUFFER, 0);
+    }
+    shader->unbind();
+}
+
+void point_cloud_record_t::draw(LightVisDetail *detail) {
+    size_t ready_levels = loader ? loader->ready_levels() : cloud->level_count();
+    if (ready_levels == 0 || cloud->empty()) return;
+    const viewport_t &viewport = detail->viewport;
+    Eigen::Matrix4f mvp = detail->projection_matrix() * detail->view_matrix() * detail->model_matrix();
+    float focal_pixels = viewport.framebuffer_size.y();
+
+    chunks.resize(cloud->chunk_count());
+    memory = &detail->gpu_memory;
+    Shader *shader = detail->bind_position_shader();
+    for (size_t i = 0; i < cloud->chunk_count(); ++i) {
+        const PointCloudChunk &chunk = cloud->chunk(i);
+        Eigen::Vector3f lo = viewport.scale * (Eigen::Vector3f::Map(chunk.aabb_min) - viewport.world_xyz);
+        Eigen::Vector3f hi = viewport.scale * (Eigen::Vector3f::Map(chunk.aabb_max) - viewport.world_xyz);
+        if ((lo.array() > 10.5f).any() || (hi.array() < -10.5f).any()) continue;
+        if (!is_box_visible(mvp, lo, hi)) continue;
+
+        // Pick the coarsest level whose grid cells project to no more than a couple of pixels.
+        size_t level = cloud->level_count() - 1;
+        float depth = (mvp * Eigen::Vector4f(0.5f * (lo.x() + hi.x()), 0.5f * (lo.y() + hi.y()), 0.5f * (lo.z() + hi.z()), 1.0f)).w();
+        if (depth > 0) {
+            float cell_pixels = (hi - lo).maxCoeff() * focal_pixels / depth / 8.0f;
+            for (size_t l = 0; l + 1 < cloud->level_count(); ++l, cell_pixels /= 2) {
+                if (cell_pixels <= LIGHTVIS_POINT_CLOUD_LOD_PIXELS) {
+                    level = l;
+                    break;
+                }
+            }
+        }
+        level = std::min(level, ready_levels - 1);
+
+        // Buffers are sized for the whole chunk but only filled up to the finest level drawn so far.
+        chunk_buffers_t &buffers = chunks[i];
+        size_t count = chunk.level_counts[level];
+        if (buffers.positions == 0) {
+            size_t capacity = chunk.level_counts[cloud->level_count() - 1];
+            gl::glGenBuffers(1, &buffers.positions);
+            gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers.positions);
+            gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(float) * 3 * capacity, nullptr, gl::GL_STATIC_DRAW);
+            gl::glGenBuffers(1, &buffers.colors);
+            gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers.colors);
+            gl::glBufferData(gl::GL_ARRAY_BUFFER, 4 * capacity, nullptr, gl::GL_STATIC_DRAW);
+            // Evicted chunks are dropped and streamed from the mapped file again when they come back into view.
+            memory->track(&buffers, gpu_memory_t::buffer, (sizeof(float) * 3 + 4) * capacity, 2, [&buffers]() {
+                gl::glDeleteBuffers(1, &buffers.positions);
+                gl::glDeleteBuffers(1, &buffers.colors);
+                buffers = chunk_buffers_t();
+                return true;
+            });
+        } else {
+            memory->touch(&buffers);
+        }
+        if (buffers.uploaded < count) {
+            size_t first = buffers.uploaded;
+            gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers.positions);
+            gl::glBufferSubData(gl::GL_ARRAY_BUFFER, sizeof(float) * 3 * first, sizeof(float) * 3 * (count - first), cloud->positions(chunk) + first * 3);
+            gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffers.colors);
+            gl::glBufferSubData(gl::GL_ARRAY_BUFFER, 4 * first, 4 * (count - first), cloud->colors(chunk) + first * 4);
+            gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+            frame_counters().upload((sizeof(float) * 3 + 4) * (count - first));
+            buffers.uploaded = count;
+        }
+        shader->set_attribute("Position", buffers.positions, 3, gl::GL_FLOAT, gl::GL_FALSE);
+        shader->set_attribute("Color", buffers.colors, 4, gl::GL_UNSIGNED_BYTE, gl::GL_TRUE);
+        shader->draw(gl::GL_POINTS, 0, count);
+    }
+    shader->unbind();
+}
+
 LightVis::LightVis(const std::string &title, int width, int height) {
     detail = std::make_unique<LightVisDetail>(this);
     detail->title = title;
@@ -982,6 +2676,43 @@ float &LightVis::scale() {
     return detail->viewport.scale;
 }
 
+const Eigen::Vector3f &LightVis::ypr() const {
+    return detail->viewport.viewport_ypr;
+}
+
+Eigen::Vector3f &LightVis::ypr() {
+    return detail->viewport.viewport_ypr;
+}
+
+const float &LightVis::distance() const {
+    return detail->viewport.viewport_distance;
+}
+
+float &LightVis::distance() {
+    return detail->viewport.viewport_distance;
+}
+
+const Stats &LightVis::stats() const {
+    return detail->stats;
+}
+
+bool &LightVis::show_stats() {
+    return detail->show_stats;
+}
+
+size_t &LightVis::memory_budget() {
+    return detail->gpu_memory.budget;
+}
+
+Arena &LightVis::frame_arena() {
+    return detail->frame_arena;
+}
+
+void *LightVis::font(float size) {
+    if (!detail->context.window) return nullptr;
+    return detail->font(size);
+}
+
 Eigen::Matrix4f LightVis::projection_matrix(float f, float near, float far) {
     return detail->projection_matrix(f, near, far);
 }
@@ -995,43 +2726,130 @@ Eigen::Matrix4f LightVis::model_matrix() {
 }
 
 Shader *LightVis::shader() {
-    return detail->position_shader.get();
+    return detail->get_position_shader();
+}
+
+Record LightVis::add_points(std::vector<Eigen::Vector3f> &points, Eigen::Vector4f &color) {
+    auto record = std::make_unique<position_record_t>();
+    record->is_trajectory = false;
+    record->data = &points;
+    record->color = &color;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_points(std::vector<Eigen::Vector3f> &points, std::vector<Eigen::Vector4f> &colors) {
+    auto record = std::make_unique<position_record_t>();
+    record->is_trajectory = false;
+    record->data = &points;
+    record->colors = &colors;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_ellipsoids(std::vector<Eigen::Vector3f> &means, std::vector<Eigen::Matrix3f> &covariances, Eigen::Vector4f &color, float sigma) {
+    auto record = std::make_unique<ellipsoid_record_t>();
+    record->means = &means;
+    record->covariances = &covariances;
+    record->color = &color;
+    record->sigma = sigma;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_ellipsoids(std::vector<Eigen::Vector3f> &means, std::vector<Eigen::Matrix3f> &covariances, std::vector<Eigen::Vector4f> &colors, float sigma) {
+    auto record = std::make_unique<ellipsoid_record_t>();
+    record->means = &means;
+    record->covariances = &covariances;
+    record->colors = &colors;
+    record->sigma = sigma;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_points(std::vector<Eigen::Vector3f> &points, std::vector<float> &scalars, Eigen::Vector2f &range, Colormap colormap) {
+    auto record = std::make_unique<scalar_record_t>();
+    record->data = &points;
+    record->scalars = &scalars;
+    record->range = &range;
+    record->colormap = colormap;
+    return detail->add_record(std::move(record));
 }
 
-void LightVis::add_points(std::vector<Eigen::Vector3f> &points, Eigen::Vector4f &color) {
-    position_record_t record;
-    record.is_trajectory = false;
-    record.data = &points;
-    record.color = &color;
-    record.colors = nullptr;
-    detail->position_records.push_back(record);
+Record LightVis::add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<double> &timestamps, Eigen::Vector2d &window, Eigen::Vector4f &color) {
+    auto record = std::make_unique<timed_trajectory_record_t>();
+    record->positions = &positions;
+    record->timestamps = &timestamps;
+    record->window = &window;
+    record->color = &color;
+    return detail->add_record(std::move(record));
 }
 
-void LightVis::add_points(std::vector<Eigen::Vector3f> &points, std::vector<Eigen::Vector4f> &colors) {
-    position_record_t record;
-    record.is_trajectory = false;
-    record.data = &points;
-    record.color = nullptr;
-    record.colors = &colors;
-    detail->position_records.push_back(record);
+Record LightVis::add_image_planes(std::vector<const Image *> &images, std::vector<Eigen::Matrix4f> &poses, Eigen::Vector4f &intrinsics, Eigen::Vector4f &color, float depth) {
+    auto record = std::make_unique<image_plane_record_t>();
+    record->images = &images;
+    record->poses = &poses;
+    record->intrinsics = &intrinsics;
+    record->color = &color;
+    record->depth = depth;
+    return detail->add_record(std::move(record));
 }
 
-void LightVis::add_trajectory(std::vector<Eigen::Vector3f> &positions, Eigen::Vector4f &color) {
-    position_record_t record;
-    record.is_trajectory = true;
-    record.data = &positions;
-    record.color = &color;
-    record.colors = nullptr;
-    detail->position_records.push_back(record);
+Record LightVis::add_trajectory(std::vector<Eigen::Vector3f> &positions, Eigen::Vector4f &color) {
+    auto record = std::make_unique<position_record_t>();
+    record->is_trajectory = true;
+    record->data = &positions;
+    record->color = &color;
+    return detail->add_record(std::move(record));
 }
 
-void LightVis::add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors) {
-    position_record_t record;
-    record.is_trajectory = true;
-    record.data = &positions;
-    record.color = nullptr;
-    record.colors = &colors;
-    detail->position_records.push_back(record);
+Record LightVis::add_trajectory(std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors) {
+    auto record = std::make_unique<position_record_t>();
+    record->is_trajectory = true;
+    record->data = &positions;
+    record->colors = &colors;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_point_cloud(const PointCloud *cloud) {
+    return detail->add_record(std::make_unique<point_cloud_record_t>(cloud));
+}
+
+Record LightVis::add_labels(std::vector<Eigen::Vector3f> &positions, std::vector<std::string> &labels, Eigen::Vector4f &color, float size) {
+    auto record = std::make_unique<label_record_t>();
+    record->positions = &positions;
+    record->labels = &labels;
+    record->color = &color;
+    record->size = size;
+    return detail->add_record(std::move(record));
+}
+
+Record LightVis::add_voxels(const VoxelGrid *grid) {
+    return detail->add_record(std::make_unique<voxel_record_t>(grid));
+}
+
+bool &LightVis::layer_visible(const std::string &layer) {
+    return detail->layers.try_emplace(layer, true).first->second;
+}
+
+void LightVis::load_async(const std::string &path) {
+    loader_base_t *loader;
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".lvpc") == 0) {
+        auto cloud_loader = std::make_unique<point_cloud_loader_t>(path);
+        auto record = std::make_unique<point_cloud_record_t>(&cloud_loader->cloud);
+        record->loader = cloud_loader.get();
+        detail->add_record(std::move(record));
+        loader = detail->loaders.emplace_back(std::move(cloud_loader)).get();
+    } else {
+        auto file_loader = std::make_unique<point_file_loader_t>(path, Eigen::Vector4f(1.0, 1.0, 1.0, 1.0));
+        auto record = std::make_unique<position_record_t>();
+        record->data = &file_loader->positions;
+        record->colors = &file_loader->colors;
+        detail->add_record(std::move(record));
+        loader = detail->loaders.emplace_back(std::move(file_loader)).get();
+    }
+    add_progress(loader->progress);
+}
+
+void LightVis::add_layer_toggles() {
+    panel_t *p = detail->get_panel();
+    p->widgets.emplace_back(std::make_unique<layer_widget_t>(p, detail->layers));
 }
 
 void LightVis::add_separator() {
@@ -1048,6 +2866,13 @@ void LightVis::add_label(const std::string &label) {
     p->widgets.emplace_back(std::make_unique<label_widget_t>(p, label));
 }
 
+std::shared_ptr<Value<std::string>> LightVis::add_label(std::string &&label) {
+    auto owned = std::make_shared<Value<std::string>>(std::move(label));
+    panel_t *p = detail->get_panel();
+    p->widgets.emplace_back(std::make_unique<label_widget_t>(p, owned));
+    return owned;
+}
+
 void LightVis::add_image(const Image *image) {
     panel_t *p = detail->get_panel();
     p->widgets.emplace_back(std::make_unique<image_widget_t>(p, image));
@@ -1058,11 +2883,55 @@ void LightVis::add_graph(const std::vector<double> &values) {
     p->widgets.emplace_back(std::make_unique<graph_widget_t>(p, values));
 }
 
+std::shared_ptr<Value<std::vector<double>>> LightVis::add_graph(std::vector<double> &&values) {
+    auto owned = std::make_shared<Value<std::vector<double>>>(std::move(values));
+    panel_t *p = detail->get_panel();
+    p->widgets.emplace_back(std::make_unique<graph_widget_t>(p, owned));
+    return owned;
+}
+
+std::shared_ptr<Histogram> LightVis::add_histogram(double lo, double hi, size_t bins) {
+    auto histogram = std::make_shared<Histogram>(lo, hi, bins);
+    panel_t *p = detail->get_panel();
+    p->widgets.emplace_back(std::make_unique<histogram_widget_t>(p, histogram));
+    return histogram;
+}
+
 void LightVis::add_progress(const double &value) {
     panel_t *p = detail->get_panel();
     p->widgets.emplace_back(std::make_unique<progress_widget_t>(p, value));
 }
 
+std::shared_ptr<Value<double>> LightVis::add_progress(double &&value) {
+    auto owned = std::make_shared<Value<double>>(std::move(value));
+    panel_t *p = detail->get_panel();
+    p->widgets.emplace_back(std::make_unique<progress_widget_t>(p, owned));
+    return owned;
+}
+
+bool LightVis::render() {
+    if (!detail->render_offscreen()) return false;
+    detail->record_frame();
+    detail->present();
+    return true;
+}
+
+bool LightVis::capture(cv::Mat &image) {
+    return detail->capture(image);
+}
+
+void LightVis::start_recording(const std::string &path, double fps) {
+    stop_recording();
+    detail->video_encoder = std::make_unique<video_encoder_t>(path, fps);
+}
+
+void LightVis::stop_recording() {
+    if (detail->context.window) {
+        detail->activate_context();
+    }
+    detail->stop_recording();
+}
+
 void LightVis::load() {
 }
 
@@ -1092,4 +2961,34 @@ int main() {
     return LightVisDetail::main();
 }
 
+void Record::remove() {
+    if (auto record = state.lock()) {
+        record->removed = true;
+    }
+}
+
+void Record::hide() {
+    if (auto record = state.lock()) {
+        record->visible = false;
+    }
+}
+
+void Record::show() {
+    if (auto record = state.lock()) {
+        record->visible = true;
+    }
+}
+
+bool Record::visible() const {
+    auto record = state.lock();
+    return record && !record->removed && record->visible;
+}
+
+void Record::set_layer(const std::string &layer) {
+    if (auto record = state.lock()) {
+        std::lock_guard<std::mutex> lock(record->layer_mutex);
+        record->layer = layer;
+    }
+}
+
 } // namespace lightvis
@@ -0,0 +1,98 @@
+#include <lightvis/loader.h>
+#include <fstream>
+
+#define LIGHTVIS_LOADER_BATCH_SIZE 65536
+
+namespace lightvis {
+
+void loader_base_t::update() {
+    progress = worker_progress.load();
+}
+
+void loader_base_t::start() {
+    worker = std::thread(&loader_base_t::run, this);
+}
+
+void loader_base_t::stop() {
+    cancelled = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+point_file_loader_t::point_file_loader_t(const std::string &path, const Eigen::Vector4f &color) :
+    path(path), color(color) {
+    start();
+}
+
+point_file_loader_t::~point_file_loader_t() {
+    stop();
+}
+
+void point_file_loader_t::update() {
+    loader_base_t::update();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &batch : batches) {
+        positions.insert(positions.end(), batch.positions.begin(), batch.positions.end());
+        colors.insert(colors.end(), batch.colors.begin(), batch.colors.end());
+    }
+    batches.clear();
+}
+
+void point_file_loader_t::run() {
+    std::ifstream file(path, std::ios::ate);
+    if (!file) {
+        fprintf(stderr, "Error loading %s.\n", path.c_str());
+        worker_progress = 1.0;
+        return;
+    }
+    double file_size = std::max(double(file.tellg()), 1.0);
+    file.seekg(0);
+    while (!cancelled) {
+        batch_t batch;
+        batch.positions.reserve(LIGHTVIS_LOADER_BATCH_SIZE);
+        batch.colors.reserve(LIGHTVIS_LOADER_BATCH_SIZE);
+        if (read_points(file, batch.positions, batch.colors, color, LIGHTVIS_LOADER_BATCH_SIZE) == 0) break;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.emplace_back(std::move(batch));
+        }
+        if (file) {
+            worker_progress = double(file.tellg()) / file_size;
+        }
+    }
+    worker_progress = 1.0;
+}
+
+point_cloud_loader_t::point_cloud_loader_t(const std::string &path) :
+    path(path) {
+    start();
+}
+
+point_cloud_loader_t::~point_cloud_loader_t() {
+    stop();
+}
+
+void point_cloud_loader_t::run() {
+    if (!cloud.open(path)) {
+        fprintf(stderr, "Error loading %s.\n", path.c_str());
+        worker_progress = 1.0;
+        return;
+    }
+    double total = std::max(double(cloud.size()), 1.0);
+    double loaded = 0;
+    for (size_t level = 0; level < cloud.level_count() && !cancelled; ++level) {
+        for (size_t i = 0; i < cloud.chunk_count() && !cancelled; ++i) {
+            const PointCloudChunk &chunk = cloud.chunk(i);
+            size_t begin = (level == 0) ? 0 : chunk.level_counts[level - 1];
+            size_t end = chunk.level_counts[level];
+            cloud.prefetch(chunk, begin, end);
+            loaded += double(end - begin);
+            worker_progress = loaded / total;
+        }
+        levels.store(level + 1, std::memory_order_release);
+    }
+    worker_progress = 1.0;
+}
+
+} // namespace lightvis
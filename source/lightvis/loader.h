@@ -0,0 +1,84 @@
+#ifndef LIGHTVIS_LOADER_H
+#define LIGHTVIS_LOADER_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Eigen>
+#include <lightvis/point_cloud.h>
+
+namespace lightvis {
+
+// Loads a file on a worker thread. update() runs on the render thread once per
+// frame and publishes what has arrived so far; progress is its render-thread copy,
+// suitable for a progress widget.
+class loader_base_t {
+  public:
+    virtual ~loader_base_t() = default;
+    virtual void update();
+
+    double progress = 0.0;
+
+  protected:
+    void start();
+    // Derived destructors call stop() first, since run() uses their members.
+    void stop();
+    virtual void run() = 0;
+
+    std::atomic<double> worker_progress = {0.0};
+    std::atomic<bool> cancelled = {false};
+
+  private:
+    std::thread worker;
+};
+
+// Parses a text point file in batches which are appended to positions/colors as they arrive.
+class point_file_loader_t : public loader_base_t {
+  public:
+    point_file_loader_t(const std::string &path, const Eigen::Vector4f &color);
+    ~point_file_loader_t() override;
+    void update() override;
+
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector4f> colors;
+
+  private:
+    void run() override;
+
+    struct batch_t {
+        std::vector<Eigen::Vector3f> positions;
+        std::vector<Eigen::Vector4f> colors;
+    };
+
+    std::string path;
+    Eigen::Vector4f color;
+    std::mutex mutex;
+    std::deque<batch_t> batches;
+};
+
+// Maps a .lvpc file and faults its pages in coarse to fine, one LOD level
+// across all chunks at a time. Levels below ready_levels() are resident.
+class point_cloud_loader_t : public loader_base_t {
+  public:
+    point_cloud_loader_t(const std::string &path);
+    ~point_cloud_loader_t() override;
+
+    size_t ready_levels() const {
+        return levels.load(std::memory_order_acquire);
+    }
+
+    PointCloud cloud;
+
+  private:
+    void run() override;
+
+    std::string path;
+    std::atomic<size_t> levels = {0};
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_LOADER_H
@@ -0,0 +1,282 @@
+#include <lightvis/point_cloud.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define LIGHTVIS_POINT_CLOUD_VERSION 1
+
+namespace lightvis {
+
+static const char point_cloud_magic[4] = {'L', 'V', 'P', 'C'};
+
+static std::uint64_t align_offset(std::uint64_t offset) {
+    return (offset + 15) & ~std::uint64_t(15);
+}
+
+// Whether count elements of the given size starting at offset lie inside the mapping,
+// written so that corrupt offsets and counts cannot wrap around.
+static bool is_span_inside(std::uint64_t offset, std::uint64_t count, std::uint64_t element_size, std::uint64_t mapping_size) {
+    if (offset > mapping_size || offset % 16 != 0) return false;
+    return count <= (mapping_size - offset) / element_size;
+}
+
+// Checks the header and every chunk, so nothing read through the mapping can go past it.
+static bool is_valid_point_cloud(const std::uint8_t *base, size_t mapping_size) {
+    if (mapping_size < sizeof(PointCloudHeader)) return false;
+    const auto *h = (const PointCloudHeader *)base;
+    if (memcmp(h->magic, point_cloud_magic, 4) != 0 || h->version != LIGHTVIS_POINT_CLOUD_VERSION) return false;
+    if (h->level_count == 0 || h->level_count > LIGHTVIS_POINT_CLOUD_MAX_LEVELS) return false;
+    if (!is_span_inside(h->chunks_offset, h->chunk_count, sizeof(PointCloudChunk), mapping_size)) return false;
+    if (!is_span_inside(h->positions_offset, h->point_count, sizeof(float) * 3, mapping_size)) return false;
+    if (!is_span_inside(h->colors_offset, h->point_count, 4, mapping_size)) return false;
+
+    const auto *chunks = (const PointCloudChunk *)(base + h->chunks_offset);
+    for (std::uint32_t i = 0; i < h->chunk_count; ++i) {
+        const PointCloudChunk &chunk = chunks[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            if (!std::isfinite(chunk.aabb_min[axis]) || !std::isfinite(chunk.aabb_max[axis]) || chunk.aabb_min[axis] > chunk.aabb_max[axis]) return false;
+        }
+        for (std::uint32_t level = 1; level < h->level_count; ++level) {
+            if (chunk.level_counts[level] < chunk.level_counts[level - 1]) return false;
+        }
+        if (chunk.first > h->point_count || chunk.level_counts[h->level_count - 1] > h->point_count - chunk.first) return false;
+    }
+    return true;
+}
+
+PointCloud::PointCloud() {
+}
+
+PointCloud::~PointCloud() {
+    close();
+}
+
+bool PointCloud::open(const std::string &path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file_mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    mapping_handle = file_mapping;
+    mapping = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+    mapping_size = (size_t)file_size.QuadPart;
+    if (!mapping) {
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *address = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) return false;
+    mapping = address;
+    mapping_size = (size_t)st.st_size;
+#endif
+
+    const auto *base = (const std::uint8_t *)mapping;
+    const auto *h = (const PointCloudHeader *)base;
+    if (!is_valid_point_cloud(base, mapping_size)) {
+        fprintf(stderr, "Error reading point cloud %s.\n", path.c_str());
+        close();
+        return false;
+    }
+
+    header = h;
+    chunks = (const PointCloudChunk *)(base + h->chunks_offset);
+    positions_data = (const float *)(base + h->positions_offset);
+    colors_data = base + h->colors_offset;
+    return true;
+}
+
+void PointCloud::close() {
+#ifdef _WIN32
+    if (mapping) UnmapViewOfFile(mapping);
+    if (mapping_handle) CloseHandle((HANDLE)mapping_handle);
+    if (file_handle) CloseHandle((HANDLE)file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (mapping) munmap(mapping, mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    header = nullptr;
+    chunks = nullptr;
+    positions_data = nullptr;
+    colors_data = nullptr;
+}
+
+void PointCloud::prefetch(const PointCloudChunk &chunk, size_t begin, size_t end) const {
+    static const size_t page_size = 4096;
+    volatile std::uint8_t sink = 0;
+    const auto *p = (const std::uint8_t *)(positions(chunk) + begin * 3);
+    const auto *p_end = (const std::uint8_t *)(positions(chunk) + end * 3);
+    for (; p < p_end; p += page_size) sink = sink + *p;
+    const std::uint8_t *c = colors(chunk) + begin * 4;
+    const std::uint8_t *c_end = colors(chunk) + end * 4;
+    for (; c < c_end; c += page_size) sink = sink + *c;
+}
+
+size_t read_points(std::istream &stream, std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors, const Eigen::Vector4f &default_color, size_t max_count) {
+    size_t count = 0;
+    std::string line;
+    while (count < max_count && std::getline(stream, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream values(line);
+        Eigen::Vector3f p;
+        if (!(values >> p.x() >> p.y() >> p.z())) continue;
+        Eigen::Vector4f c = default_color;
+        if (values >> c.x() >> c.y() >> c.z()) {
+            if (!(values >> c.w())) c.w() = 1.0;
+        }
+        positions.push_back(p);
+        colors.push_back(c);
+        count++;
+    }
+    return count;
+}
+
+static void split_chunks(const std::vector<Eigen::Vector3f> &positions, std::vector<std::uint32_t> &indices, size_t chunk_size, std::vector<std::pair<size_t, size_t>> &ranges) {
+    std::vector<std::pair<size_t, size_t>> stack = {{0, indices.size()}};
+    while (!stack.empty()) {
+        auto [begin, end] = stack.back();
+        stack.pop_back();
+        if (end - begin <= chunk_size) {
+            ranges.emplace_back(begin, end);
+            continue;
+        }
+        Eigen::AlignedBox3f box;
+        for (size_t i = begin; i < end; ++i) {
+            box.extend(positions[indices[i]]);
+        }
+        Eigen::Vector3f::Index axis;
+        box.sizes().maxCoeff(&axis);
+        size_t mid = (begin + end) / 2;
+        std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end, [&](std::uint32_t a, std::uint32_t b) {
+            return positions[a][axis] < positions[b][axis];
+        });
+        stack.emplace_back(mid, end);
+        stack.emplace_back(begin, mid);
+    }
+}
+
+// Level l keeps at most one point per cell of an (8 << l)^3 grid over the chunk,
+// the last level holds all the remaining points.
+static void order_levels(const std::vector<Eigen::Vector3f> &positions, std::uint32_t *indices, size_t count, size_t level_count, PointCloudChunk &chunk) {
+    Eigen::AlignedBox3f box;
+    for (size_t i = 0; i < count; ++i) {
+        box.extend(positions[indices[i]]);
+    }
+    Eigen::Vector3f::Map(chunk.aabb_min) = box.min();
+    Eigen::Vector3f::Map(chunk.aabb_max) = box.max();
+    Eigen::Vector3f extent = box.sizes().cwiseMax(1.0e-6f);
+
+    std::vector<std::uint32_t> ordered, remaining(indices, indices + count), skipped;
+    ordered.reserve(count);
+    for (size_t level = 0; level + 1 < level_count; ++level) {
+        std::int64_t resolution = std::int64_t(8) << level;
+        std::unordered_set<std::uint64_t> occupied;
+        skipped.clear();
+        for (std::uint32_t index : remaining) {
+            Eigen::Vector3f cell = (positions[index] - box.min()).cwiseQuotient(extent) * float(resolution);
+            std::uint64_t key = 0;
+            for (int k = 0; k < 3; ++k) {
+                key = key * resolution + std::clamp<std::int64_t>((std::int64_t)cell[k], 0, resolution - 1);
+            }
+            if (occupied.insert(key).second) {
+                ordered.push_back(index);
+            } else {
+                skipped.push_back(index);
+            }
+        }
+        chunk.level_counts[level] = (std::uint32_t)ordered.size();
+        std::swap(remaining, skipped);
+    }
+    ordered.insert(ordered.end(), remaining.begin(), remaining.end());
+    chunk.level_counts[level_count - 1] = (std::uint32_t)ordered.size();
+    std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+bool write_point_cloud(const std::string &path, const std::vector<Eigen::Vector3f> &positions, const std::vector<Eigen::Vector4f> &colors, size_t chunk_size, size_t level_count) {
+    level_count = std::clamp<size_t>(level_count, 1, LIGHTVIS_POINT_CLOUD_MAX_LEVELS);
+    chunk_size = std::max<size_t>(chunk_size, 1);
+
+    std::vector<std::uint32_t> indices(positions.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = (std::uint32_t)i;
+    }
+    std::vector<std::pair<size_t, size_t>> ranges;
+    split_chunks(positions, indices, chunk_size, ranges);
+
+    std::vector<PointCloudChunk> chunks(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        auto [begin, end] = ranges[i];
+        memset(&chunks[i], 0, sizeof(PointCloudChunk));
+        chunks[i].first = begin;
+        order_levels(positions, indices.data() + begin, end - begin, level_count, chunks[i]);
+    }
+
+    PointCloudHeader header;
+    memset(&header, 0, sizeof(PointCloudHeader));
+    memcpy(header.magic, point_cloud_magic, 4);
+    header.version = LIGHTVIS_POINT_CLOUD_VERSION;
+    header.point_count = positions.size();
+    header.chunk_count = (std::uint32_t)chunks.size();
+    header.level_count = (std::uint32_t)level_count;
+    header.chunks_offset = align_offset(sizeof(PointCloudHeader));
+    header.positions_offset = align_offset(header.chunks_offset + chunks.size() * sizeof(PointCloudChunk));
+    header.colors_offset = align_offset(header.positions_offset + positions.size() * sizeof(float) * 3);
+
+    std::vector<float> position_column(positions.size() * 3);
+    std::vector<std::uint8_t> color_column(positions.size() * 4, 255);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        Eigen::Vector3f::Map(&position_column[i * 3]) = positions[indices[i]];
+        if (indices[i] < colors.size()) {
+            Eigen::Vector4f c = (colors[indices[i]].cwiseMax(0.0f).cwiseMin(1.0f) * 255.0f).array().round();
+            Eigen::Matrix<std::uint8_t, 4, 1>::Map(&color_column[i * 4]) = c.cast<std::uint8_t>();
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    auto write_at = [&file](std::uint64_t offset, const void *data, size_t size) {
+        while ((std::uint64_t)file.tellp() < offset) file.put(0);
+        file.write((const char *)data, size);
+    };
+    write_at(0, &header, sizeof(PointCloudHeader));
+    write_at(header.chunks_offset, chunks.data(), chunks.size() * sizeof(PointCloudChunk));
+    write_at(header.positions_offset, position_column.data(), position_column.size() * sizeof(float));
+    write_at(header.colors_offset, color_column.data(), color_column.size());
+    return bool(file);
+}
+
+} // namespace lightvis
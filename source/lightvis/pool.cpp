@@ -0,0 +1,95 @@
+#include <lightvis/pool.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace lightvis {
+
+namespace {
+
+// Precedes every block, padded to keep the payload aligned for any type.
+struct alignas(std::max_align_t) block_header_t {
+    size_t size_class;
+    size_t size;
+};
+
+constexpr size_t large_class = ~size_t(0);
+
+} // namespace
+
+pool_allocator_t::~pool_allocator_t() {
+    for (auto &list : free_lists) {
+        while (list) {
+            free_block_t *next = list->next;
+            std::free((block_header_t *)list - 1);
+            list = next;
+        }
+    }
+}
+
+void *pool_allocator_t::allocate(size_t size) {
+    size_t size_class = 0;
+    while (size_class < class_count && (size_t(1) << (size_class + min_class_shift)) < size) {
+        size_class++;
+    }
+
+    block_header_t *header;
+    if (size_class == class_count) {
+        header = (block_header_t *)std::malloc(sizeof(block_header_t) + size);
+        if (!header) return nullptr;
+        header->size_class = large_class;
+        held_bytes += size;
+    } else if (free_block_t *block = free_lists[size_class]) {
+        free_lists[size_class] = block->next;
+        header = (block_header_t *)block - 1;
+    } else {
+        size_t class_size = size_t(1) << (size_class + min_class_shift);
+        header = (block_header_t *)std::malloc(sizeof(block_header_t) + class_size);
+        if (!header) return nullptr;
+        header->size_class = size_class;
+        held_bytes += class_size;
+    }
+    header->size = size;
+
+    used_bytes += size;
+    max_used_bytes = std::max(max_used_bytes, used_bytes);
+    allocation_count++;
+    frame_allocation_count++;
+    return header + 1;
+}
+
+void pool_allocator_t::deallocate(void *ptr) {
+    if (!ptr) return;
+    block_header_t *header = (block_header_t *)ptr - 1;
+    used_bytes -= header->size;
+    if (header->size_class == large_class) {
+        held_bytes -= header->size;
+        std::free(header);
+    } else {
+        auto block = (free_block_t *)ptr;
+        block->next = free_lists[header->size_class];
+        free_lists[header->size_class] = block;
+    }
+}
+
+void pool_allocator_t::next_frame() {
+    last_frame_allocation_count = frame_allocation_count;
+    frame_allocation_count = 0;
+}
+
+static void *pool_alloc(nk_handle usr, void *old, nk_size size) {
+    return ((pool_allocator_t *)usr.ptr)->allocate(size);
+}
+
+static void pool_free(nk_handle usr, void *ptr) {
+    ((pool_allocator_t *)usr.ptr)->deallocate(ptr);
+}
+
+nk_allocator pool_allocator_t::nuklear() {
+    nk_allocator allocator;
+    allocator.userdata = nk_handle_ptr(this);
+    allocator.alloc = pool_alloc;
+    allocator.free = pool_free;
+    return allocator;
+}
+
+} // namespace lightvis
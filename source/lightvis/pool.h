@@ -0,0 +1,66 @@
+#ifndef LIGHTVIS_POOL_H
+#define LIGHTVIS_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <nuklear.h>
+
+namespace lightvis {
+
+// Size-class pool behind nuklear's allocator interface. Freed blocks are kept in
+// per-class free lists and reused, so a GUI of steady size stops hitting malloc,
+// and the counters bound and expose how much memory nuklear holds.
+// Not thread-safe, each window owns its own pool.
+class pool_allocator_t {
+  public:
+    pool_allocator_t() = default;
+    ~pool_allocator_t();
+    pool_allocator_t(const pool_allocator_t &) = delete;
+    pool_allocator_t &operator=(const pool_allocator_t &) = delete;
+
+    void *allocate(size_t size);
+    void deallocate(void *ptr);
+
+    // Starts counting allocations for a new frame.
+    void next_frame();
+
+    nk_allocator nuklear();
+
+    // Bytes requested by live allocations.
+    size_t bytes() const {
+        return used_bytes;
+    }
+    size_t peak_bytes() const {
+        return max_used_bytes;
+    }
+    // Bytes held from the system, including free lists.
+    size_t reserved_bytes() const {
+        return held_bytes;
+    }
+    size_t allocations() const {
+        return allocation_count;
+    }
+    size_t frame_allocations() const {
+        return last_frame_allocation_count;
+    }
+
+  private:
+    static constexpr size_t min_class_shift = 5;
+    static constexpr size_t class_count = 16;
+
+    struct free_block_t {
+        free_block_t *next;
+    };
+
+    std::array<free_block_t *, class_count> free_lists = {};
+    size_t used_bytes = 0;
+    size_t max_used_bytes = 0;
+    size_t held_bytes = 0;
+    size_t allocation_count = 0;
+    size_t frame_allocation_count = 0;
+    size_t last_frame_allocation_count = 0;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_POOL_H
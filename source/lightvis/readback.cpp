@@ -0,0 +1,73 @@
+#include <lightvis/readback.h>
+
+namespace lightvis {
+
+readback_t::readback_t() {
+    for (auto &slot : slots) {
+        gl::glGenBuffers(1, &slot.buffer);
+    }
+}
+
+readback_t::~readback_t() {
+    for (auto &slot : slots) {
+        if (slot.fence) {
+            gl::glDeleteSync(slot.fence);
+        }
+        gl::glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+void readback_t::read(int width, int height, const callback_t &ready) {
+    if (!pending.empty() && pending.front() == next) {
+        deliver(next, ready);
+        pending.pop_front();
+    }
+
+    slot_t &slot = slots[next];
+    size_t size = size_t(width) * size_t(height) * 3;
+    gl::glBindBuffer(gl::GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        gl::glBufferData(gl::GL_PIXEL_PACK_BUFFER, size, nullptr, gl::GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 1);
+    gl::glReadPixels(0, 0, width, height, gl::GL_BGR, gl::GL_UNSIGNED_BYTE, nullptr);
+    gl::glBindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = gl::glFenceSync(gl::GL_SYNC_GPU_COMMANDS_COMPLETE, gl::GL_NONE_BIT);
+    slot.width = width;
+    slot.height = height;
+    pending.push_back(next);
+    next = (next + 1) % slots.size();
+
+    while (!pending.empty()) {
+        gl::GLenum status = gl::glClientWaitSync(slots[pending.front()].fence, gl::GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != gl::GL_ALREADY_SIGNALED && status != gl::GL_CONDITION_SATISFIED) break;
+        deliver(pending.front(), ready);
+        pending.pop_front();
+    }
+}
+
+void readback_t::finish(const callback_t &ready) {
+    while (!pending.empty()) {
+        deliver(pending.front(), ready);
+        pending.pop_front();
+    }
+}
+
+void readback_t::deliver(size_t index, const callback_t &ready) {
+    slot_t &slot = slots[index];
+    gl::glClientWaitSync(slot.fence, gl::GL_SYNC_FLUSH_COMMANDS_BIT, gl::GL_TIMEOUT_IGNORED);
+    gl::glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    gl::glBindBuffer(gl::GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (void *pixels = gl::glMapBuffer(gl::GL_PIXEL_PACK_BUFFER, gl::GL_READ_ONLY)) {
+        cv::Mat image;
+        cv::flip(cv::Mat(slot.height, slot.width, CV_8UC3, pixels), image, 0);
+        gl::glUnmapBuffer(gl::GL_PIXEL_PACK_BUFFER);
+        ready(std::move(image));
+    }
+    gl::glBindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+}
+
+} // namespace lightvis
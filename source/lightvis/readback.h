@@ -0,0 +1,51 @@
+#ifndef LIGHTVIS_READBACK_H
+#define LIGHTVIS_READBACK_H
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <glbinding/gl/gl.h>
+
+namespace lightvis {
+
+// Reads the framebuffer through a ring of pixel buffers so that glReadPixels
+// returns immediately; frames are handed out a few frames later, once their
+// fences have signaled, avoiding a pipeline stall on every frame.
+class readback_t {
+  public:
+    using callback_t = std::function<void(cv::Mat &&)>;
+
+    readback_t();
+    ~readback_t();
+
+    void read(int width, int height, const callback_t &ready);
+    void finish(const callback_t &ready);
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (const auto &slot : slots) {
+            total += slot.capacity;
+        }
+        return total;
+    }
+
+  private:
+    struct slot_t {
+        gl::GLuint buffer = 0;
+        gl::GLsync fence = nullptr;
+        size_t capacity = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    void deliver(size_t index, const callback_t &ready);
+
+    std::array<slot_t, 3> slots;
+    std::deque<size_t> pending;
+    size_t next = 0;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_READBACK_H
@@ -0,0 +1,70 @@
+#include <lightvis/video_encoder.h>
+
+#define LIGHTVIS_VIDEO_ENCODER_QUEUE_SIZE 8
+
+namespace lightvis {
+
+static int fourcc_from_path(const std::string &path) {
+    std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    if (extension == ".avi") {
+        return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    } else {
+        return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    }
+}
+
+video_encoder_t::video_encoder_t(const std::string &path, double fps) :
+    path(path), fps(fps) {
+    worker = std::thread(&video_encoder_t::run, this);
+}
+
+video_encoder_t::~video_encoder_t() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frame_pushed.notify_one();
+    worker.join();
+}
+
+void video_encoder_t::push(cv::Mat &&frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    frame_popped.wait(lock, [this] { return failed || frames.size() < LIGHTVIS_VIDEO_ENCODER_QUEUE_SIZE; });
+    if (failed) return;
+    frames.emplace_back(std::move(frame));
+    lock.unlock();
+    frame_pushed.notify_one();
+}
+
+void video_encoder_t::run() {
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_pushed.wait(lock, [this] { return stopping || !frames.empty(); });
+            if (frames.empty()) break;
+            frame = std::move(frames.front());
+            frames.pop_front();
+        }
+        frame_popped.notify_one();
+
+        if (!writer.isOpened()) {
+            frame_size = frame.size();
+            if (!writer.open(path, fourcc_from_path(path), fps, frame_size)) {
+                fprintf(stderr, "Error opening video %s.\n", path.c_str());
+                std::lock_guard<std::mutex> lock(mutex);
+                frames.clear();
+                failed = true;
+                frame_popped.notify_all();
+                break;
+            }
+        }
+        if (frame.size() != frame_size) {
+            cv::resize(frame, frame, frame_size);
+        }
+        writer.write(frame);
+    }
+    writer.release();
+}
+
+} // namespace lightvis
@@ -0,0 +1,43 @@
+#ifndef LIGHTVIS_VIDEO_ENCODER_H
+#define LIGHTVIS_VIDEO_ENCODER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+namespace lightvis {
+
+// Encodes frames with cv::VideoWriter on a worker thread. The writer is
+// opened on the first frame; later frames are resized to match if needed.
+class video_encoder_t {
+  public:
+    video_encoder_t(const std::string &path, double fps);
+    ~video_encoder_t();
+
+    // Blocks while the queue is full so that no frame is dropped.
+    // Frames are discarded if the video cannot be opened.
+    void push(cv::Mat &&frame);
+
+  private:
+    void run();
+
+    std::string path;
+    double fps;
+    cv::VideoWriter writer;
+    cv::Size frame_size;
+
+    std::deque<cv::Mat> frames;
+    std::mutex mutex;
+    std::condition_variable frame_pushed;
+    std::condition_variable frame_popped;
+    bool stopping = false;
+    bool failed = false;
+    std::thread worker;
+};
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_VIDEO_ENCODER_H
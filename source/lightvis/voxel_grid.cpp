@@ -0,0 +1,63 @@
+#include <lightvis/voxel_grid.h>
+#include <algorithm>
+
+namespace lightvis {
+
+std::uint64_t VoxelGrid::brick_key(const Eigen::Vector3i &brick) {
+    // 21 bits per axis, enough for +-2^20 bricks of 8 voxels.
+    auto axis = [](int v) {
+        return std::uint64_t(v) & ((std::uint64_t(1) << 21) - 1);
+    };
+    return axis(brick.x()) | (axis(brick.y()) << 21) | (axis(brick.z()) << 42);
+}
+
+Eigen::Vector3i VoxelGrid::brick_of(const Eigen::Vector3i &cell) {
+    // Arithmetic shift rounds toward negative infinity, unlike division.
+    return {cell.x() >> 3, cell.y() >> 3, cell.z() >> 3};
+}
+
+int VoxelGrid::voxel_index(const Eigen::Vector3i &cell) {
+    return (cell.x() & 7) | ((cell.y() & 7) << 3) | ((cell.z() & 7) << 6);
+}
+
+void VoxelGrid::set(const Eigen::Vector3i &cell, const Eigen::Vector4f &color) {
+    Eigen::Vector3i brick = brick_of(cell);
+    auto [it, inserted] = brick_map.try_emplace(brick_key(brick));
+    Brick &b = it->second;
+    if (inserted) {
+        b.origin = brick * brick_size;
+        b.voxels.fill(0);
+    }
+    Eigen::Matrix<std::uint8_t, 4, 1> rgba = (color.cwiseMax(0.0f).cwiseMin(1.0f) * 255.0f + Eigen::Vector4f::Constant(0.5f)).cast<std::uint8_t>();
+    std::uint32_t value = std::uint32_t(rgba[0]) | (std::uint32_t(rgba[1]) << 8) | (std::uint32_t(rgba[2]) << 16) | (std::uint32_t(std::max<std::uint8_t>(rgba[3], 1)) << 24);
+    std::uint32_t &voxel = b.voxels[voxel_index(cell)];
+    if (voxel == value) return;
+    if (voxel == 0) b.occupied++;
+    voxel = value;
+    b.version = ++version;
+}
+
+void VoxelGrid::reset(const Eigen::Vector3i &cell) {
+    auto it = brick_map.find(brick_key(brick_of(cell)));
+    if (it == brick_map.end()) return;
+    Brick &b = it->second;
+    std::uint32_t &voxel = b.voxels[voxel_index(cell)];
+    if (voxel == 0) return;
+    voxel = 0;
+    if (--b.occupied == 0) {
+        brick_map.erase(it);
+    } else {
+        b.version = ++version;
+    }
+}
+
+bool VoxelGrid::occupied(const Eigen::Vector3i &cell) const {
+    auto it = brick_map.find(brick_key(brick_of(cell)));
+    return it != brick_map.end() && it->second.voxels[voxel_index(cell)] != 0;
+}
+
+void VoxelGrid::clear() {
+    brick_map.clear();
+}
+
+} // namespace lightvis
@@ -0,0 +1,273 @@
+//
+// lightvis_bench
+// Replays a deterministic camera path offscreen and compares frame timings
+// and allocation counts against a stored baseline.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <lightvis/lightvis.h>
+#include "session.h"
+
+static std::atomic<size_t> allocation_count = {0};
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+using namespace lightvis;
+
+static void usage() {
+    puts("usage: lightvis_bench [options]");
+    puts("  -i, --input <file>        session, point file or .lvpc to render (default: synthetic scene)");
+    puts("  -n, --points <n>          synthetic scene size (default 1000000)");
+    puts("  -p, --path <file>         camera path script (default: a full orbit)");
+    puts("  -f, --frames <n>          frames when no path is given (default 240)");
+    puts("  -s, --size <w>x<h>        frame size (default 1280x720)");
+    puts("  -b, --baseline <file>     compare against a baseline, exit 1 on regression");
+    puts("  -w, --write-baseline <file> store the results as a new baseline");
+    puts("  -t, --tolerance <ratio>   allowed relative slowdown (default 0.15)");
+}
+
+struct keyframe_t {
+    int frame;
+    camera_t camera;
+};
+
+// Camera path scripts are camera lines grouped by "key <frame>" lines; each key
+// starts from the previous one, and frames in between are interpolated linearly.
+static bool load_path(const std::string &path, std::vector<keyframe_t> &keys) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream values(line);
+        std::string key;
+        if (!(values >> key) || key[0] == '#') continue;
+        if (key == "key") {
+            keyframe_t keyframe = keys.empty() ? keyframe_t{0, camera_t()} : keys.back();
+            if (!(values >> keyframe.frame)) return false;
+            keys.push_back(keyframe);
+        } else if (keys.empty() || !parse_camera_line(key, values, keys.back().camera)) {
+            fprintf(stderr, "%s: cannot handle \"%s\".\n", path.c_str(), line.c_str());
+            return false;
+        }
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const keyframe_t &a, const keyframe_t &b) { return a.frame < b.frame; });
+    return !keys.empty();
+}
+
+static camera_t interpolate(const std::vector<keyframe_t> &keys, int frame) {
+    auto next = std::upper_bound(keys.begin(), keys.end(), frame, [](int f, const keyframe_t &k) { return f < k.frame; });
+    if (next == keys.begin()) return keys.front().camera;
+    if (next == keys.end()) return keys.back().camera;
+    const keyframe_t &a = *(next - 1);
+    const keyframe_t &b = *next;
+    float t = float(frame - a.frame) / float(b.frame - a.frame);
+    camera_t camera;
+    camera.location = a.camera.location + t * (b.camera.location - a.camera.location);
+    camera.scale = a.camera.scale * std::pow(b.camera.scale / a.camera.scale, t);
+    camera.ypr = a.camera.ypr + t * (b.camera.ypr - a.camera.ypr);
+    camera.distance = a.camera.distance + t * (b.camera.distance - a.camera.distance);
+    return camera;
+}
+
+static void make_synthetic(session_t &session, size_t count) {
+    std::mt19937 rng(0);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    session_record_t &points = session.records.emplace_back();
+    for (size_t i = 0; i < count; ++i) {
+        Eigen::Vector3f center(std::floor(uniform(rng) * 4) * 2 - 3, std::floor(uniform(rng) * 4) * 2 - 3, 0);
+        points.positions.emplace_back(center + 0.5f * Eigen::Vector3f(normal(rng), normal(rng), normal(rng)));
+        points.colors.emplace_back(uniform(rng), uniform(rng), uniform(rng), 1.0f);
+    }
+    session_record_t &trajectory = session.records.emplace_back();
+    trajectory.is_trajectory = true;
+    for (int i = 0; i < 10000; ++i) {
+        float t = i * 0.01f;
+        trajectory.positions.emplace_back(4 * std::cos(t), 4 * std::sin(t), t * 0.05f - 2.5f);
+        trajectory.colors.emplace_back(1.0f, 1.0f, 0.0f, 1.0f);
+    }
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    size_t k = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+static bool load_metrics(const std::string &path, std::map<std::string, double> &metrics) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string name;
+    double value;
+    while (file >> name >> value) {
+        metrics[name] = value;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::string input, path_file, baseline_file, output_file;
+    size_t point_count = 1000000;
+    int frame_count = 240;
+    int width = 1280, height = 720;
+    double tolerance = 0.15;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if ((arg == "-i" || arg == "--input") && has_value) {
+            input = argv[++i];
+        } else if ((arg == "-n" || arg == "--points") && has_value) {
+            point_count = (size_t)std::max(0, atoi(argv[++i]));
+        } else if ((arg == "-p" || arg == "--path") && has_value) {
+            path_file = argv[++i];
+        } else if ((arg == "-f" || arg == "--frames") && has_value) {
+            frame_count = std::max(1, atoi(argv[++i]));
+        } else if ((arg == "-s" || arg == "--size") && has_value) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else if ((arg == "-b" || arg == "--baseline") && has_value) {
+            baseline_file = argv[++i];
+        } else if ((arg == "-w" || arg == "--write-baseline") && has_value) {
+            output_file = argv[++i];
+        } else if ((arg == "-t" || arg == "--tolerance") && has_value) {
+            tolerance = atof(argv[++i]);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    session_t session;
+    if (input.empty()) {
+        make_synthetic(session, point_count);
+    } else if (!load_session(input, session)) {
+        fprintf(stderr, "Error loading %s.\n", input.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<keyframe_t> keys;
+    if (path_file.empty()) {
+        keyframe_t start{0, session.camera};
+        keyframe_t end{frame_count, session.camera};
+        end.camera.ypr.x() += 360;
+        keys = {start, end};
+    } else if (!load_path(path_file, keys)) {
+        fprintf(stderr, "Error loading camera path %s.\n", path_file.c_str());
+        return EXIT_FAILURE;
+    } else {
+        frame_count = keys.back().frame + 1;
+    }
+
+    LightVis vis("lightvis_bench", width, height);
+    session.apply(vis);
+
+    // Warm up: creates the context, compiles shaders and fills lazily created buffers.
+    for (int i = 0; i < 5; ++i) {
+        interpolate(keys, 0).apply(vis);
+        if (!vis.render()) {
+            fprintf(stderr, "Error creating offscreen context.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    gl::glFinish();
+
+    std::vector<gl::GLuint> queries(frame_count);
+    gl::glGenQueries(frame_count, queries.data());
+    std::vector<double> cpu_ms, gpu_ms, allocations;
+    for (int frame = 0; frame < frame_count; ++frame) {
+        interpolate(keys, frame).apply(vis);
+        size_t allocations_before = allocation_count.load();
+        auto start = std::chrono::steady_clock::now();
+        gl::glBeginQuery(gl::GL_TIME_ELAPSED, queries[frame]);
+        vis.render();
+        gl::glEndQuery(gl::GL_TIME_ELAPSED);
+        auto end = std::chrono::steady_clock::now();
+        cpu_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        allocations.push_back(double(allocation_count.load() - allocations_before));
+    }
+    gl::glFinish();
+    for (int frame = 0; frame < frame_count; ++frame) {
+        gl::GLuint64 elapsed = 0;
+        gl::glGetQueryObjectui64v(queries[frame], gl::GL_QUERY_RESULT, &elapsed);
+        gpu_ms.push_back(double(elapsed) * 1.0e-6);
+    }
+    gl::glDeleteQueries(frame_count, queries.data());
+
+    std::map<std::string, double> metrics;
+    metrics["cpu_ms_median"] = percentile(cpu_ms, 0.5);
+    metrics["cpu_ms_p95"] = percentile(cpu_ms, 0.95);
+    metrics["gpu_ms_median"] = percentile(gpu_ms, 0.5);
+    metrics["gpu_ms_p95"] = percentile(gpu_ms, 0.95);
+    metrics["allocations_per_frame"] = percentile(allocations, 0.5);
+
+    if (!output_file.empty()) {
+        std::ofstream file(output_file);
+        for (const auto &[name, value] : metrics) {
+            file << name << " " << value << "\n";
+        }
+        if (!file) {
+            fprintf(stderr, "Error writing %s.\n", output_file.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_file.empty() && !load_metrics(baseline_file, baseline)) {
+        fprintf(stderr, "Error loading baseline %s.\n", baseline_file.c_str());
+        return EXIT_FAILURE;
+    }
+
+    bool regressed = false;
+    printf("%-24s %12s %12s\n", "metric", "current", "baseline");
+    for (const auto &[name, value] : metrics) {
+        if (baseline.count(name)) {
+            // Allocation counts get one allocation of slack, timings a relative tolerance.
+            double limit = baseline[name] * (1.0 + tolerance) + (name == "allocations_per_frame" ? 1.0 : 0.0);
+            bool failed = value > limit;
+            regressed = regressed || failed;
+            printf("%-24s %12.3f %12.3f%s\n", name.c_str(), value, baseline[name], failed ? "  REGRESSED" : "");
+        } else {
+            printf("%-24s %12.3f %12s\n", name.c_str(), value, "-");
+        }
+    }
+
+    return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+//
+// lightvis_convert
+// Converts point files or sessions into the memory-mapped .lvpc format.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <lightvis/point_cloud.h>
+#include "session.h"
+
+using namespace lightvis;
+
+static void usage() {
+    puts("usage: lightvis_convert [options] <session.lvs | points.txt> <output.lvpc>");
+    puts("  -c, --chunk-size <n>  points per chunk (default 65536)");
+    puts("  -l, --levels <n>      level of detail count, 1 to 8 (default 6)");
+}
+
+int main(int argc, char *argv[]) {
+    size_t chunk_size = 65536;
+    size_t level_count = 6;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if ((arg == "-c" || arg == "--chunk-size") && has_value) {
+            chunk_size = (size_t)std::max(1, atoi(argv[++i]));
+        } else if ((arg == "-l" || arg == "--levels") && has_value) {
+            level_count = (size_t)std::max(1, atoi(argv[++i]));
+        } else if (arg[0] == '-') {
+            usage();
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    session_t session;
+    if (!load_session(paths[0], session)) {
+        fprintf(stderr, "Error loading %s.\n", paths[0].c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector4f> colors;
+    for (const auto &record : session.records) {
+        if (record.is_trajectory) continue;
+        positions.insert(positions.end(), record.positions.begin(), record.positions.end());
+        colors.insert(colors.end(), record.colors.begin(), record.colors.end());
+    }
+
+    if (!write_point_cloud(paths[1], positions, colors, chunk_size, level_count)) {
+        fprintf(stderr, "Error writing %s.\n", paths[1].c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%s: %zu points.\n", paths[1].c_str(), positions.size());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+//
+// lightvis_fontbake
+// Bakes the GUI font atlases at build time into a C++ source compiled into lightvis,
+// so windows no longer rasterize the TTF at startup. One atlas is baked per pixel size
+// given on the command line, HiDPI windows pick the larger ones.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define NK_IMPLEMENTATION
+#include <nuklear.h>
+
+#include <lightvis/font.h>
+#include <lightvis/lightvis_font_roboto.h>
+
+using namespace lightvis;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        puts("usage: lightvis_fontbake <output.cpp> [pixel sizes...]");
+        return EXIT_FAILURE;
+    }
+    std::vector<float> sizes;
+    for (int i = 2; i < argc; ++i) {
+        float size = (float)atof(argv[i]);
+        if (size <= 0) {
+            fprintf(stderr, "Error invalid font size %s.\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        sizes.push_back(size);
+    }
+    if (sizes.empty()) {
+        sizes.push_back(LIGHTVIS_FONT_SIZE);
+    }
+    std::vector<font_atlas_storage_t> atlases(sizes.size());
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if (!bake_font_atlas(Roboto_Regular_ttf, Roboto_Regular_ttf_len, sizes[i], atlases[i])) {
+            fprintf(stderr, "Error baking font atlas at %g px.\n", sizes[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!write_font_atlas_source(argv[1], atlases)) {
+        fprintf(stderr, "Error writing %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
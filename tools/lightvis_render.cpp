@@ -0,0 +1,137 @@
+//
+// lightvis_render
+// Renders sessions or point files offscreen to PNG without showing a window.
+// Nodes without a display render on the CPU through OSMesa.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <lightvis/lightvis.h>
+#include "session.h"
+
+using namespace lightvis;
+
+static void usage() {
+    puts("usage: lightvis_render [options] <session.lvs | points.txt>...");
+    puts("  -c, --camera <file>     camera applied to every input (overrides session cameras)");
+    puts("  -s, --size <w>x<h>      output size (default 1280x720, or the session size)");
+    puts("  -o, --output-dir <dir>  directory for <name>.png outputs (default .)");
+    puts("  -j, --jobs <n>          parallel loading/encoding jobs (default: hardware threads)");
+}
+
+struct options_t {
+    std::string camera;
+    int width = 0;
+    int height = 0;
+    std::string output_dir = ".";
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+};
+
+static bool parse_options(int argc, char *argv[], options_t &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if ((arg == "-c" || arg == "--camera") && has_value) {
+            options.camera = argv[++i];
+        } else if ((arg == "-s" || arg == "--size") && has_value) {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if ((arg == "-o" || arg == "--output-dir") && has_value) {
+            options.output_dir = argv[++i];
+        } else if ((arg == "-j" || arg == "--jobs") && has_value) {
+            options.jobs = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+static std::unique_ptr<session_t> load(const std::string &input, const options_t &options) {
+    auto session = std::make_unique<session_t>();
+    if (!load_session(input, *session)) {
+        fprintf(stderr, "Error loading %s.\n", input.c_str());
+        return nullptr;
+    }
+    if (!options.camera.empty() && !load_camera(options.camera, session->camera)) {
+        fprintf(stderr, "Error loading camera %s.\n", options.camera.c_str());
+        return nullptr;
+    }
+    if (options.width > 0 && options.height > 0) {
+        session->width = options.width;
+        session->height = options.height;
+    }
+    if (session->output.empty()) {
+        session->output = (std::filesystem::path(options.output_dir) / (session->name + ".png")).string();
+    }
+    return session;
+}
+
+int main(int argc, char *argv[]) {
+    options_t options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    std::filesystem::create_directories(options.output_dir);
+
+    // Parsing and PNG encoding run on worker threads, while GL rendering stays
+    // on the main thread since GLFW only creates windows there.
+    std::deque<std::future<std::unique_ptr<session_t>>> loading;
+    std::deque<std::future<bool>> encoding;
+    size_t next_input = 0;
+    auto schedule_loading = [&]() {
+        while (next_input < options.inputs.size() && loading.size() < options.jobs) {
+            loading.emplace_back(std::async(std::launch::async, load, options.inputs[next_input++], std::cref(options)));
+        }
+    };
+
+    int failures = 0;
+    schedule_loading();
+    while (!loading.empty()) {
+        std::unique_ptr<session_t> session = loading.front().get();
+        loading.pop_front();
+        schedule_loading();
+        if (!session) {
+            failures++;
+            continue;
+        }
+
+        cv::Mat image;
+        {
+            LightVis vis(session->name, session->width, session->height);
+            session->apply(vis);
+            if (!vis.capture(image)) {
+                fprintf(stderr, "Error rendering %s.\n", session->name.c_str());
+                failures++;
+                continue;
+            }
+        }
+
+        while (encoding.size() >= options.jobs) {
+            failures += encoding.front().get() ? 0 : 1;
+            encoding.pop_front();
+        }
+        encoding.emplace_back(std::async(std::launch::async, [image, output = session->output]() {
+            if (!cv::imwrite(output, image)) {
+                fprintf(stderr, "Error writing %s.\n", output.c_str());
+                return false;
+            }
+            return true;
+        }));
+    }
+    while (!encoding.empty()) {
+        failures += encoding.front().get() ? 0 : 1;
+        encoding.pop_front();
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+#include "session.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <lightvis/lightvis.h>
+
+namespace lightvis {
+
+void camera_t::apply(LightVis &vis) const {
+    vis.location() = location;
+    vis.scale() = scale;
+    vis.ypr() = ypr;
+    vis.distance() = distance;
+}
+
+void session_t::apply(LightVis &vis) {
+    camera.apply(vis);
+    for (auto &record : records) {
+        if (record.is_trajectory) {
+            vis.add_trajectory(record.positions, record.colors);
+        } else {
+            vis.add_points(record.positions, record.colors);
+        }
+    }
+    for (auto &cloud : clouds) {
+        vis.add_point_cloud(cloud.get());
+    }
+}
+
+bool parse_camera_line(const std::string &key, std::istream &values, camera_t &camera) {
+    if (key == "location") {
+        values >> camera.location.x() >> camera.location.y() >> camera.location.z();
+    } else if (key == "scale") {
+        values >> camera.scale;
+    } else if (key == "ypr") {
+        values >> camera.ypr.x() >> camera.ypr.y() >> camera.ypr.z();
+    } else if (key == "distance") {
+        values >> camera.distance;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool load_camera(const std::string &path, camera_t &camera) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream values(line);
+        std::string key;
+        if (!(values >> key) || key[0] == '#') continue;
+        if (!parse_camera_line(key, values, camera)) {
+            fprintf(stderr, "%s: unknown camera key \"%s\".\n", path.c_str(), key.c_str());
+        }
+    }
+    return true;
+}
+
+bool save_camera(const std::string &path, const camera_t &camera) {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << "location " << camera.location.x() << " " << camera.location.y() << " " << camera.location.z() << "\n";
+    file << "scale " << camera.scale << "\n";
+    file << "ypr " << camera.ypr.x() << " " << camera.ypr.y() << " " << camera.ypr.z() << "\n";
+    file << "distance " << camera.distance << "\n";
+    return true;
+}
+
+bool load_points(const std::string &path, std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors, const Eigen::Vector4f &default_color) {
+    std::ifstream file(path);
+    if (!file) return false;
+    read_points(file, positions, colors, default_color);
+    return true;
+}
+
+static bool load_session_record(const std::filesystem::path &base, std::istream &values, bool is_trajectory, session_t &session) {
+    std::string file;
+    if (!(values >> file)) return false;
+    Eigen::Vector4f color = {1.0, 1.0, 1.0, 1.0};
+    values >> color.x() >> color.y() >> color.z() >> color.w();
+    session_record_t &record = session.records.emplace_back();
+    record.is_trajectory = is_trajectory;
+    return load_points((base / file).string(), record.positions, record.colors, color);
+}
+
+static bool load_session_cloud(const std::string &path, session_t &session) {
+    auto cloud = std::make_unique<PointCloud>();
+    if (!cloud->open(path)) return false;
+    session.clouds.emplace_back(std::move(cloud));
+    return true;
+}
+
+bool load_session(const std::string &path, session_t &session) {
+    std::filesystem::path session_path(path);
+    session.name = session_path.stem().string();
+    if (session_path.extension() == ".lvpc") {
+        return load_session_cloud(path, session);
+    } else if (session_path.extension() != ".lvs") {
+        session_record_t &record = session.records.emplace_back();
+        return load_points(path, record.positions, record.colors, {1.0, 1.0, 1.0, 1.0});
+    }
+
+    std::ifstream file(path);
+    if (!file) return false;
+    std::filesystem::path base = session_path.parent_path();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream values(line);
+        std::string key;
+        if (!(values >> key) || key[0] == '#') continue;
+        bool success = true;
+        if (key == "size") {
+            success = bool(values >> session.width >> session.height);
+        } else if (key == "camera") {
+            std::string camera;
+            success = (values >> camera) && load_camera((base / camera).string(), session.camera);
+        } else if (key == "points") {
+            success = load_session_record(base, values, false, session);
+        } else if (key == "trajectory") {
+            success = load_session_record(base, values, true, session);
+        } else if (key == "cloud") {
+            std::string cloud;
+            success = (values >> cloud) && load_session_cloud((base / cloud).string(), session);
+        } else if (key == "output") {
+            std::string output;
+            success = bool(values >> output);
+            session.output = (base / output).string();
+        } else {
+            success = parse_camera_line(key, values, session.camera);
+        }
+        if (!success) {
+            fprintf(stderr, "%s: cannot handle \"%s\".\n", path.c_str(), line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace lightvis
@@ -0,0 +1,59 @@
+#ifndef LIGHTVIS_TOOLS_SESSION_H
+#define LIGHTVIS_TOOLS_SESSION_H
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Eigen>
+#include <lightvis/point_cloud.h>
+
+namespace lightvis {
+
+class LightVis;
+
+struct camera_t {
+    Eigen::Vector3f location = {0, 0, 0};
+    float scale = 1.0;
+    Eigen::Vector3f ypr = {-45, -42, 0};
+    float distance = 15;
+
+    void apply(LightVis &vis) const;
+};
+
+struct session_record_t {
+    bool is_trajectory = false;
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector4f> colors;
+};
+
+struct session_t {
+    std::string name;
+    std::string output;
+    int width = 1280;
+    int height = 720;
+    camera_t camera;
+    std::vector<session_record_t> records;
+    std::vector<std::unique_ptr<PointCloud>> clouds;
+
+    void apply(LightVis &vis);
+};
+
+// Parses "key values..." lines of a camera file:
+//   location x y z / scale s / ypr yaw pitch roll / distance d
+bool parse_camera_line(const std::string &key, std::istream &values, camera_t &camera);
+bool load_camera(const std::string &path, camera_t &camera);
+bool save_camera(const std::string &path, const camera_t &camera);
+
+// Loads a text point file, see read_points().
+bool load_points(const std::string &path, std::vector<Eigen::Vector3f> &positions, std::vector<Eigen::Vector4f> &colors, const Eigen::Vector4f &default_color);
+
+// Session files (.lvs) accept camera lines plus:
+//   size w h / camera file / points file [r g b a] / trajectory file [r g b a] / cloud file.lvpc / output file
+// Relative paths are resolved against the session file. A .lvpc input is opened as a single cloud,
+// any other input is loaded as a single point file.
+bool load_session(const std::string &path, session_t &session);
+
+} // namespace lightvis
+
+#endif // LIGHTVIS_TOOLS_SESSION_H